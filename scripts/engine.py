@@ -5,14 +5,181 @@ import mediapipe as mp
 import json
 import time
 import sys
+import os
+import mmap
+import struct
+import argparse
 
-# 配置
-Param_InPort  = "6000" # 接收 Camera (SUB)
-Param_OutImg  = "6001" # 发送 Preview (PUB)
-Param_OutPose = "6002" # 发送 Keypoints (PUB)
-Param_IP      = "127.0.0.1"
+# 默认端点, PoseBridge 启动时通过命令行传入实际端点
+DEFAULT_FRAMES_ENDPOINT  = "tcp://127.0.0.1:6000" # 接收 Camera (SUB, connect)
+DEFAULT_PREVIEW_ENDPOINT = "tcp://*:6001"         # 发送 Preview (PUB, bind)
+DEFAULT_POSE_ENDPOINT    = "tcp://*:6002"         # 发送 Keypoints (PUB, bind)
+
+# 共享内存帧环 (与 src/shm_ring.h 的布局一致)
+SHM_RING_MAGIC = 0x52534250
+SHM_HDR_SIZE   = 64
+RING_HDR = struct.Struct("<IIIII12xQ")  # magic, version, slot_count, slot_stride, max_frame_bytes, write_seq
+SLOT_HDR = struct.Struct("<QIIIII")     # seq, width, height, step, channels, data_bytes
+SLOT_SEQ = struct.Struct("<Q")
+
+# 姿态数据包 (与 src/pose_format.h 的 PoseHeader 一致)
+POSE_MAGIC   = 0x53504250
+POSE_VERSION = 2
+POSE_HDR     = struct.Struct("<IHHQqqHHBBHq")  # magic, version, header_size, frame_id, capture_us, inference_us, person_count, keypoint_count, components, layout, source_id, engine_recv_us
+POSE_LAYOUT_WORLD_XYZV = 0
+POSE_LAYOUT_IMAGE_XYZV = 1
+
+def now_us():
+    return time.time_ns() // 1000
+
+# 多路同步组: 缓存中最多保留的待分组帧数
+SYNC_PENDING_MAX = 32
+
+# 各通道的负载丢弃策略 (与 src/delivery.h 一致); 由 PoseBridge 通过命令行传入
+POLICIES = ("conflate", "drop_oldest", "lossless")
+LOSSLESS_BURST = 64
+
+# 受 PoseBridge 监管时 (--control): 心跳间隔; --standby 进程加载模型后等待 activate 再占用端口
+HEARTBEAT_S = 0.1
+BIND_RETRY_S = 1.0
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="PoseBridge MediaPipe engine")
+    for ch, policy, depth in (("frames", "conflate", 2), ("preview", "conflate", 2), ("pose", "drop_oldest", 8)):
+        parser.add_argument(f"--{ch}-policy", choices=POLICIES, default=policy)
+        parser.add_argument(f"--{ch}-depth", type=int, default=depth)
+    parser.add_argument("--frames-endpoint", default=DEFAULT_FRAMES_ENDPOINT)
+    parser.add_argument("--preview-endpoint", default=DEFAULT_PREVIEW_ENDPOINT)
+    parser.add_argument("--pose-endpoint", default=DEFAULT_POSE_ENDPOINT)
+    parser.add_argument("--control", default="", help="PoseBridge 控制端点 (心跳与命令)")
+    parser.add_argument("--id", type=int, default=0, help="心跳中报告的进程编号")
+    parser.add_argument("--standby", action="store_true", help="预热后等待 activate 命令")
+    parser.add_argument("--warm-cams", default="0", help="预热的相机编号, 逗号分隔")
+    args = parser.parse_args()
+    if args.standby and not args.control:
+        parser.error("--standby requires --control")
+    return args
+
+def bind_retry(sock, addr):
+    """接管时旧进程可能刚被结束、端口尚未释放，短暂重试"""
+    deadline = time.monotonic() + BIND_RETRY_S
+    while True:
+        try:
+            sock.bind(addr)
+            return
+        except zmq.ZMQError:
+            if time.monotonic() >= deadline:
+                raise
+            time.sleep(0.01)
+
+# 一个通道最多复用的流数 (各路相机 + 帧通道的 sync 消息), 与 src/delivery.h 一致
+MAX_CHANNEL_STREAMS = 16
+
+def hwm(policy, depth):
+    # ZMQ_CONFLATE 不支持多帧消息; 丢弃在 drain 后按主题进行并计数, HWM 为每路留出余量,
+    # 否则队列满时 ZMQ 会静默丢掉最新的消息 (含 sync)。0 表示不限
+    if policy == "lossless":
+        return 0
+    limit = 1 if policy == "conflate" else max(1, depth)
+    return (limit + 1) * MAX_CHANNEL_STREAMS
+
+def drain(sock, policy):
+    """非阻塞取出所有已到达的完整消息 (lossless 每次最多 LOSSLESS_BURST 条)"""
+    msgs = []
+    while policy != "lossless" or len(msgs) < LOSSLESS_BURST:
+        try:
+            msgs.append(sock.recv_multipart(zmq.NOBLOCK))
+        except zmq.Again:
+            break
+    return msgs
+
+def apply_policy(msgs, policy, depth):
+    """按主题只保留最新的 1 (conflate) / depth (drop_oldest) 条; 待分组帧不在此丢弃，由分组逻辑淘汰"""
+    if policy == "lossless":
+        return msgs
+    limit = 1 if policy == "conflate" else max(1, depth)
+    seen, keep = {}, []
+    for m in reversed(msgs):
+        topic, meta, _ = m
+        if topic != b"sync" and meta.get("sync"):
+            keep.append(m)
+            continue
+        if seen.get(topic, 0) < limit:
+            seen[topic] = seen.get(topic, 0) + 1
+            keep.append(m)
+    keep.reverse()
+    return keep
+
+def split_frame_msg(msg):
+    # [topic, meta, payload]; 旧版为 [meta, payload]
+    topic = msg[0] if len(msg) >= 3 else b""
+    meta_raw, payload = (msg[1], msg[2]) if len(msg) >= 3 else (msg[0], msg[1])
+    return topic, (json.loads(meta_raw) if meta_raw else {}), payload
+
+def person_box(landmarks, meta, frame):
+    """可见关键点的包围框, 从裁剪图映射回整幅画面 (meta 中 crop_x / crop_y)"""
+    pts = [(lm.x, lm.y) for lm in landmarks if lm.visibility >= 0.5]
+    if not pts:
+        return {}
+    h, w = frame.shape[:2]
+    ox, oy = meta.get("crop_x", 0), meta.get("crop_y", 0)
+    xs = [ox + min(max(x, 0.0), 1.0) * w for x, _ in pts]
+    ys = [oy + min(max(y, 0.0), 1.0) * h for _, y in pts]
+    x0, y0 = int(min(xs)), int(min(ys))
+    return {"roi_x": x0, "roi_y": y0, "roi_w": int(max(xs)) - x0, "roi_h": int(max(ys)) - y0}
+
+def image_keypoints(landmarks, meta, frame):
+    """图像关键点 (x, y, z, visibility), 从裁剪图映射为整幅画面的归一化坐标, 供 PoseBridge 绘制骨架"""
+    h, w = frame.shape[:2]
+    ox, oy = meta.get("crop_x", 0), meta.get("crop_y", 0)
+    fw, fh = meta.get("full_w", w), meta.get("full_h", h)
+    kp = []
+    for lm in landmarks:
+        kp.extend([(ox + lm.x * w) / fw, (oy + lm.y * h) / fh, lm.z, lm.visibility])
+    return kp
+
+def pack_pose(frame_id, capture_us, recv_us, people, keypoint_count, layout=POSE_LAYOUT_WORLD_XYZV, source_id=0):
+    header = POSE_HDR.pack(POSE_MAGIC, POSE_VERSION, POSE_HDR.size, frame_id, capture_us, now_us(),
+                           len(people), keypoint_count, 4, layout, source_id, recv_us)
+    body = np.asarray(people, dtype=np.float32).tobytes() if people else b""
+    return header + body
+
+class ShmFrameReader:
+    def __init__(self, name):
+        self.name = name
+        if os.name == "nt":
+            head = mmap.mmap(-1, SHM_HDR_SIZE, tagname=name, access=mmap.ACCESS_READ)
+            _, _, slots, stride, _, _ = RING_HDR.unpack_from(head, 0)
+            head.close()
+            self.buf = mmap.mmap(-1, SHM_HDR_SIZE + slots * stride, tagname=name, access=mmap.ACCESS_READ)
+        else:
+            fd = os.open("/dev/shm/" + name, os.O_RDONLY)
+            try:
+                self.buf = mmap.mmap(fd, 0, access=mmap.ACCESS_READ)
+            finally:
+                os.close(fd)
+        magic, _, self.slot_count, self.slot_stride, _, _ = RING_HDR.unpack_from(self.buf, 0)
+        if magic != SHM_RING_MAGIC:
+            self.buf.close()
+            raise ValueError(f"bad shm ring magic in {name}")
+
+    def read(self, slot, seq):
+        # 拷贝后再次校验 seq，写端已覆盖该槽位则丢弃此帧
+        off = SHM_HDR_SIZE + slot * self.slot_stride
+        cur, w, h, step, ch, _ = SLOT_HDR.unpack_from(self.buf, off)
+        if cur != seq:
+            return None
+        rows = np.frombuffer(self.buf, np.uint8, count=h * step, offset=off + SHM_HDR_SIZE).reshape(h, step)
+        frame = rows[:, :w * ch].reshape(h, w, ch).copy()
+        if SLOT_SEQ.unpack_from(self.buf, off)[0] != seq:
+            return None
+        return frame
+
+    def close(self):
+        self.buf.close()
 
 def main():
+    args = parse_args()
     print(f"[Py] Starting Inference Engine...")
     
     # 1. Setup ZMQ
@@ -20,69 +187,207 @@ def main():
     
     # Receiver: Camera Frames
     socket_sub = context.socket(zmq.SUB)
-    socket_sub.connect(f"tcp://{Param_IP}:{Param_InPort}")
-    socket_sub.setsockopt_string(zmq.SUBSCRIBE, "") # 订阅所有
+    socket_sub.setsockopt(zmq.RCVHWM, hwm(args.frames_policy, args.frames_depth))
     
     # Publisher: Preview Image
     socket_pub_img = context.socket(zmq.PUB)
-    socket_pub_img.bind(f"tcp://*:{Param_OutImg}")
+    socket_pub_img.setsockopt(zmq.SNDHWM, hwm(args.preview_policy, args.preview_depth))
     
     # Publisher: Keypoints
     socket_pub_pose = context.socket(zmq.PUB)
-    socket_pub_pose.bind(f"tcp://*:{Param_OutPose}")
+    socket_pub_pose.setsockopt(zmq.SNDHWM, hwm(args.pose_policy, args.pose_depth))
+
+    # 数据端口在接管 (activate) 时才连接/绑定, 备用进程不与正在服务的进程争用
+    def activate():
+        bind_retry(socket_pub_img, args.preview_endpoint)
+        bind_retry(socket_pub_pose, args.pose_endpoint)
+        socket_sub.connect(args.frames_endpoint)
+        socket_sub.setsockopt_string(zmq.SUBSCRIBE, "") # 订阅所有 (camN / ext / sync)
 
-    # 2. Setup Mediapipe
+    # PoseBridge 通过 outputs 命令告知需要哪些输出; 未受监管时始终发送预览
+    wanted = {"preview": 1, "cam": -1}  # cam = -1: 所有相机
+
+    # Control: 心跳 (DEALER -> PoseBridge ROUTER)
+    control = None
+    if args.control:
+        control = context.socket(zmq.DEALER)
+        control.setsockopt(zmq.IDENTITY, f"engine-{args.id}".encode())
+        control.setsockopt(zmq.LINGER, 0)
+        control.connect(args.control)
+
+    # 心跳在主循环中发送: 推理卡住时心跳随之停止, PoseBridge 据此切换到备用进程
+    # loading: 正在加载模型, PoseBridge 期间放宽超时且不把备用进程视为就绪
+    status = {"active": not args.standby, "loading": False, "last_beat": 0.0}
+    def beat(force=False):
+        if control is None:
+            return
+        now = time.monotonic()
+        if not force and now - status["last_beat"] < HEARTBEAT_S:
+            return
+        msg = json.dumps({"id": args.id, "state": "active" if status["active"] else "ready", "loading": int(status["loading"])})
+        try:
+            control.send_string(msg, zmq.NOBLOCK)
+        except zmq.Again:
+            pass
+        status["last_beat"] = now
+
+    # 2. Setup Mediapipe (每路相机一个实例, 跟踪状态互不干扰)
+    # 实例会用上一帧的关键点定位下一帧: ROI 裁剪帧与整幅关键帧视野不同, 各用一个实例,
+    # 避免每次切换时在错误的区域搜索并把两种视野的关键点平滑到一起
     mp_pose = mp.solutions.pose
-    pose = mp_pose.Pose(
-        static_image_mode=False,
-        model_complexity=1,
-        enable_segmentation=False,
-        min_detection_confidence=0.5
-    )
+    poses = {}
+    blank = np.zeros((256, 256, 3), np.uint8)
+    def pose_for(cam, cropped=False):
+        key = (cam, cropped)
+        if key not in poses:
+            # 运行中新增的相机在首帧时才加载模型, 加载与首次推理可能超过心跳超时:
+            # 期间心跳带 loading 标记, 并先推理一帧空白图, 免得被当作卡住而结束
+            status["loading"] = True
+            beat(True)
+            poses[key] = mp_pose.Pose(
+                static_image_mode=False,
+                model_complexity=1,
+                enable_segmentation=False,
+                min_detection_confidence=0.5
+            )
+            beat(True)
+            poses[key].process(blank)
+            status["loading"] = False
+            beat(True)
+        return poses[key]
     mp_drawing = mp.solutions.drawing_utils
 
-    print("[Py] Ready and waiting for frames...")
+    # 预热: 先创建实例并推理一帧空白图, 接管时无需再加载模型; 相机选择变化时 PoseBridge 发送 warm 命令
+    def warm(cams):
+        for cam in (int(c) for c in cams.split(",") if c.strip()):
+            pose_for(cam)
+    warm(args.warm_cams)
+
+    shm_readers = {}
+    pending = {}  # frame_id -> (meta, payload 或 shm 帧, recv_us), 等待 sync 消息
+    dropped = 0   # 本进程丢弃的帧数, 随姿态摘要回报给 PoseBridge
+
+    def read_frame(meta, payload):
+        if "shm" in meta:
+            # 本地共享内存模式: payload 为空，从该路相机的环中读取原始 BGR 帧
+            cam = meta.get("cam", 0)
+            reader = shm_readers.get(cam)
+            if reader is None or reader.name != meta["shm"]:
+                if reader is not None:
+                    reader.close()
+                reader = shm_readers[cam] = ShmFrameReader(meta["shm"])
+            return reader.read(meta["slot"], meta["frame_id"])
+        # Decode Image
+        return cv2.imdecode(np.frombuffer(payload, np.uint8), cv2.IMREAD_COLOR)
+
+    def process(meta, frame, recv_us):
+        cam = meta.get("cam", 0)
+        frame_id = meta.get("frame_id", 0)
+        capture_us = meta.get("capture_us", 0)
+
+        # 4. Inference
+        results = pose_for(cam, "crop_x" in meta).process(cv2.cvtColor(frame, cv2.COLOR_BGR2RGB))
+        # 无人查看预览时跳过绘制与 JPEG 编码, PoseBridge 自行绘制骨架
+        preview = wanted["preview"] and wanted["cam"] in (-1, cam)
+
+        # 5. Prepare Keypoints Data
+        kp_list, kp_img = [], []
+        if results.pose_landmarks:
+            # Draw Skeleton on frame
+            if preview:
+                mp_drawing.draw_landmarks(
+                    frame, results.pose_landmarks, mp_pose.POSE_CONNECTIONS)
+            
+            # Extract 3D Keypoints (x, y, z, visibility)
+            for lm in results.pose_world_landmarks.landmark:
+                kp_list.extend([lm.x, lm.y, lm.z, lm.visibility])
+            kp_img = image_keypoints(results.pose_landmarks.landmark, meta, frame)
+
+        # 6. Send Preview Image (JPG)
+        if preview:
+            _, buffer = cv2.imencode('.jpg', frame, [int(cv2.IMWRITE_JPEG_QUALITY), 70])
+            meta_img = json.dumps({"w": frame.shape[1], "h": frame.shape[0], "ts": time.time(),
+                                   "frame_id": frame_id, "capture_us": capture_us, "cam": cam})
+            socket_pub_img.send_multipart([meta_img.encode('utf-8'), buffer.tobytes()])
+
+        # 7. Send Keypoints [摘要, 世界坐标包, 图像坐标包] (PoseHeader + Float32 块); 未检测到人时 person_count = 0
+        people = [kp_list] if kp_list else []
+        people_img = [kp_img] if kp_img else []
+        kp_count = len(kp_list) // 4
+        summary = {"count": kp_count, "people": len(people), "frame_id": frame_id, "cam": cam, "dropped": dropped}
+        if results.pose_landmarks:
+            # 人物框 (整幅画面像素坐标), PoseBridge 据此只发送人物附近的裁剪区域
+            summary.update(person_box(results.pose_landmarks.landmark, meta, frame))
+        meta_pose = json.dumps(summary)
+        socket_pub_pose.send_multipart([meta_pose.encode('utf-8'), pack_pose(frame_id, capture_us, recv_us, people, kp_count, source_id=cam),
+                                        pack_pose(frame_id, capture_us, recv_us, people_img, kp_count, POSE_LAYOUT_IMAGE_XYZV, cam)])
+
+    if status["active"]:
+        activate()
+        print("[Py] Ready and waiting for frames...")
+    else:
+        print("[Py] Warm, standing by.")
 
     while True:
         try:
-            # 3. Receive Frame (Multipart: Header + JPEG Bytes)
-            # 使用 NOBLOCK 避免死锁，实际使用中可以用 Poller
-            if socket_sub.poll(10): 
-                msg = socket_sub.recv_multipart()
-                # msg[0] 是 metadata (JSON), msg[1] 是图片数据
-                
-                # Decode Image
-                np_arr = np.frombuffer(msg[1], np.uint8)
-                frame = cv2.imdecode(np_arr, cv2.IMREAD_COLOR)
-                
-                if frame is None:
+            if control is not None:
+                beat()
+                while control.poll(0):
+                    cmd = control.recv()
+                    if cmd == b"activate" and not status["active"]:
+                        activate()
+                        status["active"] = True
+                        print("[Py] Active.")
+                    elif cmd.startswith(b"outputs "):
+                        wanted.update(json.loads(cmd[8:]))
+                    elif cmd.startswith(b"warm "):
+                        warm(cmd[5:].decode())
+                if not status["active"]:
+                    control.poll(int(HEARTBEAT_S * 1000))
                     continue
 
-                # 4. Inference
-                results = pose.process(cv2.cvtColor(frame, cv2.COLOR_BGR2RGB))
-                
-                # 5. Prepare Keypoints Data
-                kp_list = []
-                if results.pose_landmarks:
-                    # Draw Skeleton on frame
-                    mp_drawing.draw_landmarks(
-                        frame, results.pose_landmarks, mp_pose.POSE_CONNECTIONS)
-                    
-                    # Extract 3D Keypoints (x, y, z, visibility)
-                    for lm in results.pose_world_landmarks.landmark:
-                        kp_list.extend([lm.x, lm.y, lm.z, lm.visibility])
-
-                # 6. Send Preview Image (JPG)
-                _, buffer = cv2.imencode('.jpg', frame, [int(cv2.IMWRITE_JPEG_QUALITY), 70])
-                
-                meta_img = json.dumps({"w": frame.shape[1], "h": frame.shape[0], "ts": time.time()})
-                socket_pub_img.send_multipart([meta_img.encode('utf-8'), buffer.tobytes()])
-
-                # 7. Send Keypoints (Binary Float32)
-                if kp_list:
-                    kp_array = np.array(kp_list, dtype=np.float32)
-                    meta_pose = json.dumps({"count": len(results.pose_world_landmarks.landmark)})
-                    socket_pub_pose.send_multipart([meta_pose.encode('utf-8'), kp_array.tobytes()])
+            # 3. Receive Frames (Multipart: Topic + Header + JPEG Bytes, 旧版为 Header + JPEG Bytes)
+            # 一次取出所有已到达的帧，再按 frames 通道策略丢弃过时的帧
+            if socket_sub.poll(10): 
+                recv_us = now_us()
+                msgs = [split_frame_msg(m) for m in drain(socket_sub, args.frames_policy)]
+                kept = apply_policy(msgs, args.frames_policy, args.frames_depth)
+                dropped += len(msgs) - len(kept)
+
+                for topic, meta, payload in kept:
+                    if topic == b"sync":
+                        # 多路同步组: 组内各路帧已先于此消息到达，一次性推理
+                        frames = meta.get("frames", [])
+                        for f in frames:
+                            item = pending.pop(f["frame_id"], None)
+                            if item is None:
+                                continue
+                            frame = item[1] if "shm" in item[0] else read_frame(item[0], item[1])
+                            if frame is not None:
+                                process(item[0], frame, item[2])
+                        # 丢弃比本组更旧、已无法成组的帧
+                        newest = max((f["frame_id"] for f in frames), default=0)
+                        stale = [k for k in pending if k < newest]
+                        for fid in stale:
+                            del pending[fid]
+                        dropped += len(stale)
+                        continue
+
+                    if meta.get("sync"):
+                        # 共享内存槽位会被复用，需立即拷出; JPEG 则等成组时再解码
+                        if "shm" in meta:
+                            payload = read_frame(meta, payload)
+                            if payload is None:
+                                continue
+                        pending[meta.get("frame_id", 0)] = (meta, payload, recv_us)
+                        while len(pending) > SYNC_PENDING_MAX:
+                            del pending[min(pending)]
+                            dropped += 1
+                        continue
+
+                    frame = read_frame(meta, payload)
+                    if frame is not None:
+                        process(meta, frame, recv_us)
             
         except KeyboardInterrupt:
             break
@@ -91,9 +396,13 @@ def main():
             break
 
     print("[Py] Shutting down.")
+    for reader in shm_readers.values():
+        reader.close()
     socket_sub.close()
     socket_pub_img.close()
     socket_pub_pose.close()
+    if control is not None:
+        control.close()
     context.term()
 
 if __name__ == "__main__":
@@ -0,0 +1,124 @@
+"""PoseBridge 紧凑姿态包 (compact 输出) 的参考解码器, 仅依赖标准库。
+
+格式见 src/pose_codec.h。用法:
+    python pose_compact.py --listen 0.0.0.0:9101
+或在其他程序中:
+    decoder = CompactPoseDecoder()
+    pose = decoder.decode(datagram)   # None 表示丢包后等待关键帧或包无效
+"""
+import argparse
+import socket
+import struct
+import sys
+
+COMPACT_MAGIC    = 0x43504250
+COMPACT_VERSION  = 1
+COMPACT_KEYFRAME = 1
+# magic, version, flags, source_id, sequence, person_count, keypoint_count, components, layout, position_shift, reserved, frame_id, latency_us, capture_us
+COMPACT_HDR = struct.Struct("<IBBHHBBBBBBIIq")
+
+
+def _varint(buf, pos):
+    """zigzag varint -> (值, 新位置)"""
+    z = shift = 0
+    while True:
+        if pos >= len(buf) or shift > 28:
+            raise ValueError("truncated varint")
+        b = buf[pos]
+        pos += 1
+        z |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return (z >> 1) ^ -(z & 1), pos
+        shift += 7
+
+
+class CompactPoseDecoder:
+    def __init__(self):
+        self.states = {}  # source_id -> (sequence, shape, ref)
+
+    def decode(self, buf):
+        """返回 dict (各字段与 PoseHeader 同名, keypoints 为 [[x, y, z, v], ...] 按人分组), 或 None"""
+        if len(buf) < COMPACT_HDR.size:
+            return None
+        (magic, version, flags, source_id, seq, persons, kps, comps, layout, shift,
+         _, frame_id, latency_us, capture_us) = COMPACT_HDR.unpack_from(buf)
+        if magic != COMPACT_MAGIC or version != COMPACT_VERSION or not 1 <= comps <= 4:
+            return None
+        positions = min(comps, 3)
+        has_v = comps >= 4
+        shape = (persons, kps, comps, layout, shift)
+        pos = COMPACT_HDR.size
+        try:
+            if flags & COMPACT_KEYFRAME:
+                ref = []
+                for _ in range(persons * kps):
+                    point = list(struct.unpack_from(f"<{positions}h", buf, pos))
+                    pos += positions * 2
+                    if has_v:
+                        point.append(buf[pos])
+                        pos += 1
+                    ref.append(point)
+            else:
+                state = self.states.get(source_id)
+                # 增量只能接在同一路的上一包之后, 否则等待下一个关键帧
+                if state is None or state[1] != shape or seq != (state[0] + 1) & 0xFFFF:
+                    self.states.pop(source_id, None)
+                    return None
+                ref = state[2]
+                mask_bytes = (kps + 7) // 8
+                for p in range(persons):
+                    mask = buf[pos:pos + mask_bytes]
+                    if len(mask) != mask_bytes:
+                        raise ValueError("truncated mask")
+                    pos += mask_bytes
+                    for k in range(kps):
+                        if mask[k // 8] & (1 << (k % 8)):
+                            point = ref[p * kps + k]
+                            for c in range(comps):
+                                d, pos = _varint(buf, pos)
+                                point[c] += d
+            if pos != len(buf):
+                raise ValueError("trailing bytes")
+        except (ValueError, struct.error):
+            self.states.pop(source_id, None)
+            return None
+        self.states[source_id] = (seq, shape, ref)
+
+        step = 1.0 / (1 << shift)
+        people = []
+        for p in range(persons):
+            person = []
+            for point in ref[p * kps:(p + 1) * kps]:
+                values = [q * step for q in point[:positions]]
+                if has_v:
+                    values.append(point[positions] / 255.0)
+                person.append(values)
+            people.append(person)
+        return {
+            "source_id": source_id, "frame_id": frame_id, "layout": layout,
+            "capture_us": capture_us, "inference_us": capture_us + latency_us,
+            "keyframe": bool(flags & COMPACT_KEYFRAME), "keypoints": people,
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="PoseBridge compact pose receiver")
+    parser.add_argument("--listen", default="0.0.0.0:9101", help="host:port")
+    args = parser.parse_args()
+    host, port = args.listen.rsplit(":", 1)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((host, int(port)))
+    decoder = CompactPoseDecoder()
+    while True:
+        buf, _ = sock.recvfrom(65536)
+        pose = decoder.decode(buf)
+        if pose is None:
+            print(f"[WAIT] {len(buf)} B, waiting for keyframe", file=sys.stderr)
+            continue
+        first = pose["keypoints"][0][0] if pose["keypoints"] else None
+        print(f"cam{pose['source_id']} frame {pose['frame_id']} {len(buf)} B "
+              f"{'K' if pose['keyframe'] else 'D'} persons={len(pose['keypoints'])} kp0={first}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,5 @@
+#include "app_state.h"
+
+const char* kStageNames[STAGE_COUNT] = { "Capture", "Encode", "Publish", "-> Engine", "Inference", "-> Pose Recv", "Raw Texture", "Preview Texture", "End to End" };
+
+AppState app;
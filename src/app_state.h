@@ -0,0 +1,309 @@
+#pragma once
+// Shared pipeline state, used by both the GUI and the headless executable.
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_enum.h"
+#include "jpeg_codec.h"
+#include "latency.h"
+#include "log_ring.h"
+#include "pose_engine.h"
+#include "pose_filter.h"
+#include "pose_output.h"
+#include "roi_tracker.h"
+#include "batch_scheduler.h"
+#include "delivery.h"
+#include "pose_format.h"
+#include "recording.h"
+#include "stage_queue.h"
+#include "thread_tuning.h"
+#include "triple_buffer.h"
+
+// --- 0. Enum & Consts ---
+enum DataSourceMode {
+    SOURCE_LOCAL_CAM = 0,
+    SOURCE_EXTERNAL_ZMQ = 1,
+    SOURCE_REPLAY = 2       // frames of a recording (recording.h), under their recorded source ids
+};
+
+enum FrameTransport {
+    TRANSPORT_JPEG = 0, // encode + send over TCP, works for remote engines
+    TRANSPORT_SHM = 1   // raw BGR in a shared-memory ring, local engine only
+};
+
+constexpr uint32_t kShmMaxFrameBytes = 1920 * 1080 * 3;
+constexpr int kMaxSources = 8; // local cameras are addressed by device index below this
+
+// Requested device mode; the driver may pick the nearest one it supports
+struct CaptureFormat {
+    int width = 640;
+    int height = 480;
+    int fps = 0;        // 0 = driver default
+    std::string fourcc; // e.g. "MJPG", "YUYV"; empty = driver default
+};
+
+struct FrameSlot {
+    cv::Mat image;
+    uint64_t seq = 0;
+    int64_t capture_us = 0;
+};
+
+struct PoseSlot {
+    PoseHeader header{};
+    std::vector<float> keypoints; // person_count * keypoint_count * components
+    int64_t recv_us = 0;
+    uint64_t seq = 0;
+};
+
+// Pipeline intervals, each measured from the previous stamp of the same frame
+enum LatencyStage {
+    STAGE_CAPTURE = 0,     // grab returned -> frame decoded
+    STAGE_ENCODE,          // -> JPEG / shm copy done
+    STAGE_PUBLISH,         // -> sent on the frame socket
+    STAGE_ENGINE_RECV,     // -> engine received it
+    STAGE_INFERENCE,       // -> inference done
+    STAGE_POSE_RECV,       // -> pose packet received here
+    STAGE_TEXTURE_RAW,     // capture -> raw frame uploaded to GL
+    STAGE_TEXTURE_PREVIEW, // capture -> engine preview uploaded to GL
+    STAGE_END_TO_END,      // capture -> pose received
+    STAGE_COUNT
+};
+
+extern const char* kStageNames[STAGE_COUNT];
+
+// C++-side stamps of a frame, looked up by frame_id when its pose comes back
+struct FrameTimeline {
+    std::atomic<uint64_t> frame_id{ 0 };
+    std::atomic<int64_t> capture_us{ 0 };
+    std::atomic<int64_t> encode_us{ 0 };
+    std::atomic<int64_t> publish_us{ 0 };
+};
+// --- 1. Global Application State ---
+struct AppState {
+    // === Settings ===
+    DataSourceMode source_mode = SOURCE_LOCAL_CAM;
+    // Local cameras captured concurrently, one worker thread each
+    std::mutex cams_mutex;
+    std::vector<CameraInfo> cameras;            // last enumeration (or its cache), guarded by cams_mutex
+    std::atomic<bool> cams_scanning{ false };
+    std::vector<int> selected_cams{ 0 };
+    std::atomic<uint64_t> cams_generation{ 0 }; // bumped whenever selected_cams changes
+    std::atomic<int> preview_cam{ 0 };          // local source shown in the image panes
+    std::atomic<int64_t> sync_tolerance_us{ 8000 }; // max capture-time spread inside a multi-view group
+    std::array<CaptureFormat, kMaxSources> cam_formats;  // by device index, guarded by cams_mutex
+    std::atomic<uint64_t> formats_generation{ 0 };       // bumped on change; capture workers reopen their device
+    // MJPG devices hand their compressed frames straight to engine.py, decoded only for the preview
+    std::atomic<bool> mjpeg_passthrough{ true };
+    std::string external_zmq_addr = "tcp://127.0.0.1:5555";
+    // SOURCE_REPLAY: recorded spacing divided by replay_speed; 0 = as fast as the pipeline takes them
+    std::string replay_path;
+    std::atomic<float> replay_speed{ 1.0f };
+    std::atomic<bool> replay_loop{ true };
+    std::atomic<int> replay_sources{ 0 }; // sources in the open recording, set by CameraThread
+    // Ship only a crop around the last pose's person box, with periodic full-frame keyframes
+    RoiSettings roi;
+    std::array<RoiTracker, kMaxSources> roi_trackers; // pose stream -> capture worker [source]
+
+    // [新增] 是否显示预览图 (控制 GPU 占用)
+    bool show_previews = true;
+    // Engine-drawn preview (skeleton burned in, re-encoded); off = the UI draws
+    // the skeleton over the raw frame and the engine skips drawing and JPEG encoding
+    std::atomic<bool> engine_preview{ false };
+    // GUI redraw pacing: on input, when a shown stream publishes a frame, and at
+    // ui_idle_fps otherwise; never above ui_fps_cap (0 = vsync only)
+    std::atomic<int> ui_fps_cap{ 60 };
+    std::atomic<int> ui_idle_fps{ 4 };
+    std::atomic<void (*)()> ui_wake{ nullptr }; // set by the GUI; the headless build leaves it unset
+    std::atomic<bool> ui_frame_ready{ false };
+
+    // ZMQ endpoints at the process boundary; engine.py is handed the matching
+    // address for each (ConnectEndpoint / BindEndpoint in zmq_context.h)
+    std::string frames_endpoint = "tcp://*:6000";          // PUB, bound here
+    std::string preview_endpoint = "tcp://127.0.0.1:6001"; // SUB, engine.py binds
+    std::string pose_endpoint = "tcp://127.0.0.1:6002";    // SUB, engine.py binds
+    std::string control_endpoint = "tcp://127.0.0.1:6003"; // ROUTER for engine.py heartbeats, bound here
+    // The spawned engine.py talks over ipc:// instead (UseLocalIpc); applies at its next launch
+    std::atomic<bool> engine_ipc{ true };
+    // CPU pinning / scheduling per thread role, picked up by running threads (ThreadTuner),
+    // and for engine.py processes at their next launch
+    std::mutex tuning_mutex;
+    std::array<ThreadTuning, THREAD_ROLE_COUNT> thread_tuning; // guarded by tuning_mutex
+    ThreadTuning engine_tuning;                                 // guarded by tuning_mutex
+    std::atomic<uint64_t> tuning_generation{ 0 };
+    // Shared context (SharedZmqContext); read once, when the first socket is made
+    int zmq_io_threads = 1;
+    std::vector<int> zmq_io_cpus; // pin its IO threads to these CPUs, empty = no pinning
+
+    std::string python_script = "scripts/engine.py";
+    // Per-channel load shedding. The drain policy applies at once; HWMs when a
+    // socket connects; engine.py picks its side up on the next launch.
+    ChannelPolicy delivery[CHANNEL_COUNT] = {
+        { DELIVERY_CONFLATE, 2 },    // frames
+        { DELIVERY_CONFLATE, 2 },    // preview
+        { DELIVERY_DROP_OLDEST, 8 }, // pose
+        { DELIVERY_CONFLATE, 2 }     // external
+    };
+
+    // Which engine LAUNCH starts; the native one reads native_engine when it starts
+    std::atomic<EngineKind> engine_kind{ ENGINE_PYTHON };
+    NativeEngineConfig native_engine;
+
+    // Frame transport to the engine
+    std::atomic<FrameTransport> frame_transport{ TRANSPORT_JPEG };
+    int shm_slots = 4;
+    // Codec for every JPEG encode/decode on this side; each thread keeps its own instance
+    std::atomic<JpegBackend> jpeg_backend{ DefaultJpegBackend() };
+
+    // === Runtime Status ===
+    std::atomic<bool> is_running{ true };
+    std::atomic<bool> camera_active{ false };
+    std::atomic<bool> backend_running{ false };
+
+    // [进程控制]
+    std::atomic<bool> engine_stop{ false };
+    // engine.py heartbeats on the control port; a warm standby process takes over
+    // when the serving one exits or misses heartbeats for engine_heartbeat_ms
+    std::atomic<bool> engine_standby{ true };
+    std::atomic<int> engine_heartbeat_ms{ 500 };
+    std::atomic<bool> standby_ready{ false };
+    std::atomic<uint64_t> engine_failovers{ 0 };
+
+    // Connection Status
+    std::atomic<bool> status_cam_pub{ false };
+    std::atomic<bool> status_prev_sub{ false };
+    std::atomic<bool> status_pose_sub{ false };
+
+    // === Installer State ===
+    std::atomic<bool> is_installing{ false };
+    std::atomic<float> install_progress{ 0.0f };
+    std::string install_status_text = "Idle";
+
+    // === Data Buffers ===
+    // One producer thread and the UI per stream; producers never wait on the UI
+    std::array<TripleBuffer<FrameSlot>, kMaxSources> raw_frames; // capture worker [source] -> UI
+    TripleBuffer<FrameSlot> preview_frames; // ReceiverThread -> UI
+    std::array<TripleBuffer<PoseSlot>, kMaxSources> poses; // ReceiverThread -> UI, by PoseHeader::source_id
+    std::array<TripleBuffer<PoseSlot>, kMaxSources> image_poses; // same, POSE_LAYOUT_IMAGE_XYZV, for the skeleton overlay
+    // In-process engine hand-off (ENGINE_NATIVE): capture workers -> scheduler -> engine -> ReceiverThread
+    BatchScheduler engine_frames;
+    StageQueue<EngineResult> engine_results{ 2 * kMaxSources };
+    // Received poses -> OpenVR / ROS 2 / VMC / UDP sinks, each on its own thread
+    PoseOutputHub outputs;
+    // SINK_COMPACT encoder (pose_codec.h), read per pose
+    std::atomic<int> compact_keyframe_interval{ 30 };
+    std::atomic<int> compact_deadband{ 2 }; // quantization steps
+    // Smoothed, extrapolated copy of every source's pose; sinks send from it when enabled
+    PoseFilterBank pose_filters;
+    // Published frames and received poses, appended while a recording is open
+    Recorder recorder;
+
+    // === Performance ===
+    LatencyHistogram latency[STAGE_COUNT];
+    std::array<FrameTimeline, 256> timelines;
+    std::atomic<uint64_t> next_frame_id{ 0 }; // shared by all sources, so frame_id stays unique
+    std::atomic<uint64_t> count_cam_frames{ 0 };
+    std::atomic<uint64_t> count_preview_frames{ 0 };
+    std::atomic<uint64_t> count_pose_packets{ 0 };
+    std::atomic<uint64_t> count_passthrough_frames{ 0 }; // camera JPEGs forwarded without re-encoding
+    std::atomic<uint64_t> count_cropped_frames{ 0 }; // frames shipped as an ROI crop...
+    std::atomic<uint64_t> count_shipped_pixels{ 0 }; // ...and pixels shipped, cropped or not
+    std::array<std::atomic<uint64_t>, CHANNEL_COUNT> dropped{}; // messages shed on this side, per channel
+    std::atomic<uint64_t> engine_dropped{ 0 };                    // frames shed inside engine.py
+    std::atomic<uint64_t> count_batches{ 0 };        // native engine forward passes...
+    std::atomic<uint64_t> count_batched_frames{ 0 }; // ...and the frames they carried
+    FrameTimeline& Timeline(uint64_t frame_id) { return timelines[frame_id % timelines.size()]; }
+
+    std::vector<CameraInfo> Cameras() {
+        std::lock_guard<std::mutex> lock(cams_mutex);
+        return cameras;
+    }
+
+    std::vector<int> SelectedCams() {
+        std::lock_guard<std::mutex> lock(cams_mutex);
+        return selected_cams;
+    }
+
+    // Sorted and de-duplicated; out-of-range indices are dropped
+    void SetSelectedCams(std::vector<int> cams) {
+        cams.erase(std::remove_if(cams.begin(), cams.end(), [](int c) { return c < 0 || c >= kMaxSources; }), cams.end());
+        std::sort(cams.begin(), cams.end());
+        cams.erase(std::unique(cams.begin(), cams.end()), cams.end());
+        std::lock_guard<std::mutex> lock(cams_mutex);
+        selected_cams = std::move(cams);
+        if (!selected_cams.empty() && std::find(selected_cams.begin(), selected_cams.end(), preview_cam.load()) == selected_cams.end()) preview_cam = selected_cams.front();
+        cams_generation++;
+    }
+
+    // role < 0: the engine processes
+    ThreadTuning Tuning(int role) {
+        std::lock_guard<std::mutex> lock(tuning_mutex);
+        return role < 0 ? engine_tuning : thread_tuning[role];
+    }
+
+    void SetTuning(int role, const ThreadTuning& t) {
+        std::lock_guard<std::mutex> lock(tuning_mutex);
+        (role < 0 ? engine_tuning : thread_tuning[role]) = t;
+        tuning_generation++;
+    }
+
+    CaptureFormat CameraFormat(int cam) {
+        std::lock_guard<std::mutex> lock(cams_mutex);
+        return cam >= 0 && cam < kMaxSources ? cam_formats[cam] : CaptureFormat{};
+    }
+
+    // cam < 0 sets every camera
+    void SetCameraFormat(int cam, const CaptureFormat& format) {
+        std::lock_guard<std::mutex> lock(cams_mutex);
+        for (int i = 0; i < kMaxSources; i++) if (cam < 0 || cam == i) cam_formats[i] = format;
+        formats_generation++;
+    }
+
+    int ActiveSourceCount() {
+        if (source_mode == SOURCE_REPLAY) return std::max(1, replay_sources.load());
+        if (source_mode != SOURCE_LOCAL_CAM) return 1;
+        std::lock_guard<std::mutex> lock(cams_mutex);
+        return (int)selected_cams.size();
+    }
+
+    // Source id whose raw frame and engine preview the UI shows; an external ZMQ feed is source 0
+    int PreviewSource() const { return source_mode == SOURCE_EXTERNAL_ZMQ ? 0 : preview_cam.load(); }
+
+    // Whether the engine should draw and send previews at all
+    bool EnginePreviewWanted() const { return show_previews && engine_preview; }
+
+    // Producers: a frame the UI would draw was published
+    void WakeUi() {
+        void (*wake)() = ui_wake.load(std::memory_order_relaxed);
+        if (!wake || !show_previews) return;
+        ui_frame_ready = true;
+        wake();
+    }
+
+    // === Logger ===
+    LogRing logs;
+    std::atomic<bool> scroll_to_bottom{ false };
+    bool echo_stdout = false; // headless: mirror log lines to stdout
+
+    // Safe from any thread, never blocks or allocates
+    void Log(std::string_view msg, LogSource source = LOG_APP) {
+        logs.Push(msg, ClassifyLog(msg), source);
+        if (echo_stdout) {
+            char stamp[9];
+            FormatLogTime((int64_t)time(0), stamp);
+            printf("[%s] %s%.*s\n", stamp, source == LOG_ENGINE ? "[PY] " : "", (int)msg.size(), msg.data());
+            fflush(stdout);
+        }
+        scroll_to_bottom = true;
+    }
+};
+
+extern AppState app;
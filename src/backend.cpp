@@ -0,0 +1,411 @@
+#include "backend.h"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <zmq.hpp>
+#include <zmq_addon.hpp>
+
+#include "app_state.h"
+#include "pipeline.h"
+#include "thread_tuning.h"
+#include "zmq_context.h"
+
+// --- Platform Specific Headers ---
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// The engine thread owns the engine (and any engine.py processes) and reaps them itself
+static std::mutex g_engine_mutex;
+static std::thread g_engine_thread;
+
+void StopBackend() {
+    app.engine_stop = true;
+}
+
+void JoinEngine() {
+    std::lock_guard<std::mutex> lock(g_engine_mutex);
+    if (g_engine_thread.joinable()) g_engine_thread.join();
+}
+
+std::string GetPythonPath() {
+    fs::path cwd = fs::current_path();
+#ifdef _WIN32
+    fs::path venv_py = cwd / "venv" / "Scripts" / "python.exe";
+    if (fs::exists(venv_py)) return venv_py.string();
+    return "python";
+#else
+    fs::path venv_py = cwd / "venv" / "bin" / "python";
+    if (fs::exists(venv_py)) return venv_py.string();
+    return "python3";
+#endif
+}
+
+// --- 1. Process Logic ---
+
+// Options handed to engine.py: its end of each channel and its side of the delivery policy on it
+static std::vector<std::string> EngineArgs() {
+    bool ipc = UseLocalIpc();
+    std::vector<std::string> args = {
+        "--frames-endpoint", ipc ? LocalIpcEndpoint("frames") : ConnectEndpoint(app.frames_endpoint),
+        "--preview-endpoint", ipc ? LocalIpcEndpoint("preview") : BindEndpoint(app.preview_endpoint),
+        "--pose-endpoint", ipc ? LocalIpcEndpoint("pose") : BindEndpoint(app.pose_endpoint)
+    };
+    for (int c : { CHANNEL_FRAMES, CHANNEL_PREVIEW, CHANNEL_POSE }) {
+        args.push_back(std::string("--") + kChannelNames[c] + "-policy"); args.push_back(kDeliveryPolicyNames[app.delivery[c].policy]);
+        args.push_back(std::string("--") + kChannelNames[c] + "-depth"); args.push_back(std::to_string(app.delivery[c].depth));
+    }
+    return args;
+}
+
+bool ExecCommand(const std::string& cmd) {
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES saAttr; saAttr.nLength = sizeof(SECURITY_ATTRIBUTES); saAttr.bInheritHandle = TRUE; saAttr.lpSecurityDescriptor = NULL;
+    HANDLE hChildOut_Rd, hChildOut_Wr;
+    if (!CreatePipe(&hChildOut_Rd, &hChildOut_Wr, &saAttr, 0)) return false;
+    SetHandleInformation(hChildOut_Rd, HANDLE_FLAG_INHERIT, 0);
+    STARTUPINFOA si; ZeroMemory(&si, sizeof(si)); si.cb = sizeof(si); si.hStdError = hChildOut_Wr; si.hStdOutput = hChildOut_Wr; si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW; si.wShowWindow = SW_HIDE;
+    PROCESS_INFORMATION pi; ZeroMemory(&pi, sizeof(pi));
+    std::string cmd_wrapped = "cmd.exe /c " + cmd;
+    std::vector<char> buf(cmd_wrapped.begin(), cmd_wrapped.end()); buf.push_back(0);
+    if (!CreateProcessA(NULL, buf.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) { CloseHandle(hChildOut_Rd); CloseHandle(hChildOut_Wr); return false; }
+    CloseHandle(hChildOut_Wr);
+    DWORD dwRead; CHAR chBuf[1024]; std::string line;
+    while (ReadFile(hChildOut_Rd, chBuf, sizeof(chBuf), &dwRead, NULL) && dwRead != 0) {
+        for (DWORD i = 0; i < dwRead; i++) { if (chBuf[i] == '\n' || chBuf[i] == '\r') { if (!line.empty()) { app.Log(line); line.clear(); } } else line += chBuf[i]; }
+    }
+    if (!line.empty()) app.Log(line);
+    WaitForSingleObject(pi.hProcess, INFINITE);
+    DWORD exitCode = 0; GetExitCodeProcess(pi.hProcess, &exitCode);
+    CloseHandle(pi.hProcess); CloseHandle(pi.hThread); CloseHandle(hChildOut_Rd);
+    return exitCode == 0;
+#else
+    FILE* pipe = popen((cmd + " 2>&1").c_str(), "r");
+    if (!pipe) return false;
+    char buffer[256];
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        std::string line = buffer;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        app.Log(line);
+    }
+    return pclose(pipe) == 0;
+#endif
+}
+
+// --- 1b. engine.py supervision ---
+// Every engine.py runs with --standby: it loads MediaPipe, then heartbeats on
+// the control socket and leaves the data ports alone until told "activate".
+// One process serves while a second one waits warm, so a crash or a stall of
+// the serving process only costs the time to kill it and activate the other.
+struct EngineProcess {
+    int id = 0;
+    bool heard = false;   // has sent a heartbeat, so the ROUTER can reach it
+    bool ready = false;   // first models loaded, heartbeating
+    bool loading = false; // loading a model for a newly selected camera
+    bool active = false;  // owns the data ports
+    std::string warm_cams; // cameras it has been told to warm
+    std::chrono::steady_clock::time_point spawned, heartbeat;
+#ifdef _WIN32
+    HANDLE process = nullptr;
+#else
+    pid_t pid = -1;
+#endif
+    std::thread reader; // stdout -> log, exits when the process does
+};
+
+static std::string EngineIdentity(int id) { return "engine-" + std::to_string(id); }
+
+// Comma-separated selected cameras, what --warm-cams and "warm" take
+static std::string WarmCamList() {
+    std::string cams;
+    for (int cam : app.SelectedCams()) cams += (cams.empty() ? "" : ",") + std::to_string(cam);
+    return cams.empty() ? "0" : cams;
+}
+
+#ifdef _WIN32
+static void ReadEngineOutput(HANDLE out) {
+    DWORD dwRead; CHAR chBuf[1024]; std::string line;
+    while (ReadFile(out, chBuf, sizeof(chBuf), &dwRead, NULL) && dwRead != 0) {
+        for (DWORD i = 0; i < dwRead; i++) { if (chBuf[i] == '\n' || chBuf[i] == '\r') { if (!line.empty()) { app.Log(line, LOG_ENGINE); line.clear(); } } else line += chBuf[i]; }
+    }
+    if (!line.empty()) app.Log(line, LOG_ENGINE);
+    CloseHandle(out);
+}
+#else
+static void ReadEngineOutput(int fd) {
+    char buffer[1024]; ssize_t bytesRead; std::string line_buffer;
+    while ((bytesRead = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < bytesRead; i++) {
+            if (buffer[i] == '\n' || buffer[i] == '\r') { if (!line_buffer.empty()) { app.Log(line_buffer, LOG_ENGINE); line_buffer.clear(); } }
+            else { line_buffer.push_back(buffer[i]); }
+        }
+    }
+    if (!line_buffer.empty()) app.Log(line_buffer, LOG_ENGINE);
+    close(fd);
+}
+#endif
+
+static std::unique_ptr<EngineProcess> SpawnEngine(std::string python_exe, std::string script_path, int id, const std::string& control) {
+    std::vector<std::string> args = EngineArgs();
+    for (const char* arg : { "--standby", "--id" }) args.push_back(arg);
+    args.push_back(std::to_string(id));
+    args.push_back("--control"); args.push_back(control);
+    auto p = std::make_unique<EngineProcess>();
+    p->id = id;
+    p->warm_cams = WarmCamList();
+    args.push_back("--warm-cams"); args.push_back(p->warm_cams);
+    p->spawned = p->heartbeat = std::chrono::steady_clock::now();
+    ThreadTuning tuning = app.Tuning(-1);
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES saAttr; saAttr.nLength = sizeof(SECURITY_ATTRIBUTES); saAttr.bInheritHandle = TRUE; saAttr.lpSecurityDescriptor = NULL;
+    HANDLE hChildOut_Rd, hChildOut_Wr;
+    if (!CreatePipe(&hChildOut_Rd, &hChildOut_Wr, &saAttr, 0)) { app.Log("[ERR] Pipe failed"); return nullptr; }
+    SetHandleInformation(hChildOut_Rd, HANDLE_FLAG_INHERIT, 0);
+    STARTUPINFOA si; ZeroMemory(&si, sizeof(si)); si.cb = sizeof(si); si.hStdError = hChildOut_Wr; si.hStdOutput = hChildOut_Wr; si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW; si.wShowWindow = SW_HIDE;
+    PROCESS_INFORMATION pi; ZeroMemory(&pi, sizeof(pi));
+    std::string cmd = "\"" + python_exe + "\" -u -X utf8 \"" + script_path + "\"";
+    for (const std::string& arg : args) cmd += " " + arg;
+    std::vector<char> buf(cmd.begin(), cmd.end()); buf.push_back(0);
+    // Suspended so affinity and priority class are in place before Python starts its threads
+    if (!CreateProcessA(NULL, buf.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi)) {
+        CloseHandle(hChildOut_Rd); CloseHandle(hChildOut_Wr);
+        app.Log("[ERR] Failed to start Python process.");
+        return nullptr;
+    }
+    std::string error;
+    if ((!tuning.cpus.empty() || tuning.priority != PRIORITY_NORMAL) && !ApplyProcessTuning(pi.hProcess, tuning, error))
+        app.Log("[ERR] Engine " + std::to_string(id) + " tuning: " + error);
+    ResumeThread(pi.hThread);
+    CloseHandle(hChildOut_Wr); CloseHandle(pi.hThread);
+    p->process = pi.hProcess;
+    p->reader = std::thread(ReadEngineOutput, hChildOut_Rd);
+#else
+    std::vector<char*> argv = { python_exe.data(), const_cast<char*>("-u"), script_path.data() };
+    for (std::string& arg : args) argv.push_back(arg.data());
+    argv.push_back(nullptr);
+    int pipe_fd[2];
+    if (pipe(pipe_fd) == -1) { app.Log("[ERR] Pipe failed"); return nullptr; }
+    // Keep this pipe out of the other engine process
+    fcntl(pipe_fd[0], F_SETFD, FD_CLOEXEC); fcntl(pipe_fd[1], F_SETFD, FD_CLOEXEC);
+    pid_t pid = fork();
+    if (pid == -1) { app.Log("[ERR] Fork failed"); close(pipe_fd[0]); close(pipe_fd[1]); return nullptr; }
+    if (pid == 0) {
+        dup2(pipe_fd[1], STDOUT_FILENO); dup2(pipe_fd[1], STDERR_FILENO);
+        ApplyTuningBeforeExec(tuning);
+        execvp(python_exe.c_str(), argv.data());
+        _exit(1);
+    }
+    close(pipe_fd[1]);
+    p->pid = pid;
+    p->reader = std::thread(ReadEngineOutput, pipe_fd[0]);
+#endif
+    app.Log("[SYS] Engine " + std::to_string(id) + " starting (standby).");
+    return p;
+}
+
+// Non-blocking; an exited process is reaped here
+static bool EngineAlive(EngineProcess& p) {
+#ifdef _WIN32
+    return p.process && WaitForSingleObject(p.process, 0) == WAIT_TIMEOUT;
+#else
+    if (p.pid <= 0) return false;
+    int status;
+    if (waitpid(p.pid, &status, WNOHANG) == 0) return true;
+    p.pid = -1;
+    return false;
+#endif
+}
+
+// Ends and reaps the process, then joins its output reader. `grace` lets it
+// exit on SIGTERM first; a replaced engine gets none, its ports are needed now.
+static void KillEngine(EngineProcess& p, std::chrono::milliseconds grace) {
+#ifdef _WIN32
+    if (p.process) {
+        if (WaitForSingleObject(p.process, 0) == WAIT_TIMEOUT) TerminateProcess(p.process, 1);
+        WaitForSingleObject(p.process, INFINITE);
+        CloseHandle(p.process);
+        p.process = nullptr;
+    }
+#else
+    if (p.pid > 0) {
+        int status;
+        if (grace.count() > 0 && kill(p.pid, SIGTERM) == 0) {
+            auto deadline = std::chrono::steady_clock::now() + grace;
+            while (waitpid(p.pid, &status, WNOHANG) == 0) {
+                if (std::chrono::steady_clock::now() >= deadline) { kill(p.pid, SIGKILL); waitpid(p.pid, &status, 0); break; }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        else { kill(p.pid, SIGKILL); waitpid(p.pid, &status, 0); }
+        p.pid = -1;
+    }
+#endif
+    if (p.reader.joinable()) p.reader.join();
+}
+
+void EngineSupervisorThread(std::string python_exe, std::string script_path) {
+    using clock = std::chrono::steady_clock;
+    zmq::socket_t control(SharedZmqContext(), zmq::socket_type::router);
+    control.set(zmq::sockopt::linger, 0);
+    std::string bind = UseLocalIpc() ? LocalIpcEndpoint("control") : app.control_endpoint;
+    try { control.bind(bind); }
+    catch (const zmq::error_t& e) { app.Log("[ERR] Engine control " + bind + ": " + e.what()); app.backend_running = false; return; }
+    std::string endpoint = ConnectEndpoint(bind);
+    app.Log("[SYS] Launching: " + python_exe + (UseLocalIpc() ? " (ipc)" : " (tcp)"));
+
+    std::unique_ptr<EngineProcess> active, standby;
+    int next_id = 1, failed_starts = 0;
+    int outputs_sent_to = 0;
+    std::string outputs_sent;
+    clock::time_point next_spawn = clock::now();
+    auto fail = [&](std::unique_ptr<EngineProcess>& p, const char* why) {
+        app.Log("[ERR] Engine " + std::to_string(p->id) + " " + why + ".");
+        if (!p->ready) { failed_starts++; next_spawn = clock::now() + std::chrono::seconds(2); }
+        if (p->active) app.engine_failovers++;
+        KillEngine(*p, std::chrono::milliseconds(0));
+        p.reset();
+    };
+
+    while (app.is_running && !app.engine_stop) {
+        zmq::pollitem_t item{ control, 0, ZMQ_POLLIN, 0 };
+        zmq::poll(&item, 1, std::chrono::milliseconds(10));
+        // Heartbeats: [identity, {"id":N,"state":"ready"|"active","loading":0|1,...}]
+        std::vector<zmq::message_t> msg;
+        while (zmq::recv_multipart(control, std::back_inserter(msg), zmq::recv_flags::dontwait)) {
+            if (msg.size() == 2) {
+                std::string_view beat(static_cast<const char*>(msg[1].data()), msg[1].size());
+                int id = (int)JsonInt(beat, "id", -1);
+                for (EngineProcess* p : { active.get(), standby.get() }) {
+                    if (!p || p->id != id) continue;
+                    p->heartbeat = clock::now();
+                    p->heard = true;
+                    p->loading = JsonInt(beat, "loading", 0) != 0;
+                    if (p->loading) continue;
+                    if (!p->ready) { failed_starts = 0; app.Log("[SYS] Engine " + std::to_string(id) + " ready."); }
+                    p->ready = true;
+                }
+            }
+            msg.clear();
+        }
+
+        clock::time_point now = clock::now();
+        auto timeout = std::chrono::milliseconds(std::max(50, app.engine_heartbeat_ms.load()));
+        // Loading MediaPipe may take a while, but not this long; a model load is not a stall
+        auto missed = [&](const EngineProcess& p) {
+            if (!p.ready) return now - p.spawned > std::chrono::milliseconds(60000);
+            return now - p.heartbeat > (p.loading ? std::chrono::milliseconds(60000) : timeout);
+        };
+        if (active && !EngineAlive(*active)) fail(active, "exited");
+        else if (active && missed(*active)) fail(active, "stopped responding");
+        if (standby && !EngineAlive(*standby)) fail(standby, "exited");
+        else if (standby && missed(*standby)) fail(standby, "stopped responding");
+
+        // Both processes load the models of newly selected cameras ahead of their first frame.
+        // The ROUTER drops messages to peers it has not heard from, so wait for the first beat.
+        std::string warm_cams = WarmCamList();
+        for (EngineProcess* p : { active.get(), standby.get() }) {
+            if (!p || !p->heard || p->warm_cams == warm_cams) continue;
+            std::string identity = EngineIdentity(p->id), warm = "warm " + warm_cams;
+            control.send(zmq::buffer(identity), zmq::send_flags::sndmore);
+            control.send(zmq::buffer(warm), zmq::send_flags::none);
+            p->warm_cams = warm_cams;
+        }
+
+        // Hand the ports to the warm process; it binds them once the old one is gone
+        if (!active && standby && standby->ready && !standby->loading) {
+            std::string identity = EngineIdentity(standby->id);
+            control.send(zmq::buffer(identity), zmq::send_flags::sndmore);
+            control.send(zmq::str_buffer("activate"), zmq::send_flags::none);
+            standby->active = true;
+            standby->heartbeat = now;
+            app.Log("[SYS] Engine " + std::to_string(standby->id) + " active.");
+            active = std::move(standby);
+        }
+        // Tell the serving engine which outputs anyone looks at; resent to every newly active one
+        if (active) {
+            std::string outputs = "outputs {\"preview\":" + std::string(app.EnginePreviewWanted() ? "1" : "0") +
+                ",\"cam\":" + std::to_string(app.PreviewSource()) + "}";
+            if (active->id != outputs_sent_to || outputs != outputs_sent) {
+                std::string identity = EngineIdentity(active->id);
+                control.send(zmq::buffer(identity), zmq::send_flags::sndmore);
+                control.send(zmq::buffer(outputs), zmq::send_flags::none);
+                outputs_sent_to = active->id;
+                outputs_sent = std::move(outputs);
+            }
+        }
+        bool want_standby = !active || app.engine_standby;
+        if (want_standby && !standby && now >= next_spawn) {
+            // A serving engine keeps tracking; only give up when there is nothing left to fail over from
+            if (failed_starts >= 3 && active) {
+                app.Log("[ERR] Standby engine failed to start 3 times; retrying in 60 s.");
+                failed_starts = 0;
+                next_spawn = now + std::chrono::seconds(60);
+            }
+            else if (failed_starts >= 3) { app.Log("[ERR] Engine failed to start 3 times; giving up."); break; }
+            else {
+                standby = SpawnEngine(python_exe, script_path, next_id++, endpoint);
+                if (!standby && active) { failed_starts++; next_spawn = now + std::chrono::seconds(2); }
+                else if (!standby) break;
+            }
+        }
+        app.standby_ready = standby && standby->ready && !standby->loading;
+    }
+
+    app.standby_ready = false;
+    for (std::unique_ptr<EngineProcess>* p : { &standby, &active })
+        if (*p) KillEngine(**p, std::chrono::milliseconds(1000));
+    app.backend_running = false;
+    app.Log("[SYS] Backend Stopped.");
+}
+
+void StartEngine(const std::string& python_exe) {
+    std::lock_guard<std::mutex> lock(g_engine_mutex);
+    if (app.backend_running) return;
+    if (g_engine_thread.joinable()) g_engine_thread.join();
+    app.backend_running = true;
+    app.engine_stop = false;
+    if (app.engine_kind == ENGINE_NATIVE) g_engine_thread = std::thread(NativeEngineThread);
+    else g_engine_thread = std::thread(EngineSupervisorThread, python_exe, app.python_script);
+}
+
+// --- 2. Installer Threads ---
+void InstallThreadFunc() {
+    app.is_installing = true;
+    app.install_progress = 0.0f;
+    app.Log("=== Installing Environment ===");
+#ifdef _WIN32
+    std::string sys_py = "python";
+#else
+    std::string sys_py = "python3";
+#endif
+    if (!ExecCommand(sys_py + " --version")) { app.Log("Error: System python not found."); app.is_installing = false; return; }
+    app.install_progress = 0.2f;
+    if (!ExecCommand(sys_py + " -m venv venv")) { app.Log("Error: Failed to create venv."); app.is_installing = false; return; }
+    app.install_progress = 0.4f;
+    fs::path cwd = fs::current_path();
+#ifdef _WIN32
+    std::string venv_pip = (cwd / "venv" / "Scripts" / "pip.exe").string();
+#else
+    std::string venv_pip = (cwd / "venv" / "bin" / "pip").string();
+#endif
+    std::string pip_cmd = "\"" + venv_pip + "\" install opencv-python pyzmq numpy mediapipe -i https://pypi.tuna.tsinghua.edu.cn/simple";
+    app.Log("Downloading packages...");
+    if (ExecCommand(pip_cmd)) { app.install_progress = 1.0f; app.install_status_text = "Success!"; app.Log("Environment Ready."); }
+    else { app.install_status_text = "Failed."; app.Log("Pip install failed."); }
+    app.is_installing = false;
+}
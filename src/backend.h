@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Engine process control and environment setup.
+// Asks the running engine to stop; its thread terminates and reaps engine.py
+void StopBackend();
+// Waits for the engine thread after StopBackend (or is_running = false); call before exit
+void JoinEngine();
+std::string GetPythonPath();
+bool ExecCommand(const std::string& cmd);
+// Runs engine.py under python_exe with a warm standby process, failing over on exit or missed heartbeats
+void EngineSupervisorThread(std::string python_exe, std::string script_path);
+// Starts the selected engine on its own thread: supervised engine.py processes, or the in-process one
+void StartEngine(const std::string& python_exe);
+void InstallThreadFunc();
@@ -0,0 +1,74 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "clock.h"
+#include "pose_engine.h"
+
+// Collects frames from every source into batches for the in-process engine.
+// Each source has at most one frame waiting: a newer frame supersedes the
+// older one, so a slow engine sees the latest view of every camera rather
+// than a backlog. A batch is dispatched once it is full (max_batch, or one
+// frame per active source) or max_delay_us after its first frame arrived.
+class BatchScheduler {
+public:
+    struct Limits {
+        int max_batch = 4;
+        int64_t max_delay_us = 2000;
+        int64_t stale_us = 100000; // capture age past which a frame is dropped at dispatch, 0 = never
+    };
+
+    void Configure(const Limits& limits) { std::lock_guard<std::mutex> lock(mutex_); limits_ = limits; }
+
+    void Push(EngineFrame frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find_if(pending_.begin(), pending_.end(), [&](const Pending& p) { return p.frame.source_id == frame.source_id; });
+            // Keeps the slot's arrival time, so the batch deadline still counts from the oldest waiter
+            if (it != pending_.end()) { it->frame = std::move(frame); superseded_++; }
+            else pending_.push_back(Pending{ std::move(frame), std::chrono::steady_clock::now() });
+        }
+        cv_.notify_one();
+    }
+
+    // Waits up to `timeout` for a first frame, then for the batch to fill.
+    // `sources` is the number of active sources. Returns false on timeout or if every frame was stale.
+    template <typename Rep, typename Period>
+    bool PopBatch(std::vector<EngineFrame>& out, int sources, std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_for(lock, timeout, [this] { return !pending_.empty(); })) return false;
+        size_t full = (size_t)std::max(1, std::min(limits_.max_batch, sources));
+        auto deadline = pending_.front().arrived + std::chrono::microseconds(limits_.max_delay_us);
+        cv_.wait_until(lock, deadline, [&] { return pending_.size() >= full; });
+        size_t n = std::min(pending_.size(), (size_t)std::max(1, limits_.max_batch));
+        int64_t now = WallClockMicros();
+        out.clear();
+        for (size_t i = 0; i < n; i++) {
+            if (limits_.stale_us > 0 && now - pending_[i].frame.capture_us > limits_.stale_us) { stale_++; continue; }
+            out.push_back(std::move(pending_[i].frame));
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + n);
+        return !out.empty();
+    }
+
+    void Clear() { std::lock_guard<std::mutex> lock(mutex_); pending_.clear(); }
+    uint64_t Superseded() const { std::lock_guard<std::mutex> lock(mutex_); return superseded_; }
+    uint64_t Stale() const { std::lock_guard<std::mutex> lock(mutex_); return stale_; }
+
+private:
+    struct Pending {
+        EngineFrame frame;
+        std::chrono::steady_clock::time_point arrived;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Pending> pending_; // one per source, in arrival order
+    Limits limits_;
+    uint64_t superseded_ = 0;
+    uint64_t stale_ = 0;
+};
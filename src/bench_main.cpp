@@ -0,0 +1,438 @@
+// posebridge_bench: micro-benchmarks of the hot paths plus an end-to-end run
+// of the real capture/receive threads against a synthetic frame source and a
+// mock engine that echoes one pose per frame. Results go out as one JSON
+// document, so runs can be diffed between releases.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zmq.hpp>
+#include <zmq_addon.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "app_state.h"
+#include "clock.h"
+#include "config.h"
+#include "jpeg_codec.h"
+#include "latency.h"
+#include "pipeline.h"
+#include "pose_codec.h"
+#include "pose_format.h"
+#include "zmq_context.h"
+#ifdef POSEBRIDGE_BENCH_GL
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "texture_streamer.h"
+#endif
+
+struct BenchOptions {
+    double seconds = 1.0;         // per micro-benchmark
+    double e2e_seconds = 5.0;
+    int e2e_fps = 60;             // synthetic source rate, 0 = as fast as it goes
+    int e2e_width = 640, e2e_height = 480;
+    bool micro = true, e2e = true;
+    std::string out;              // empty: stdout
+};
+
+static BenchOptions opts;
+using Clock = std::chrono::steady_clock;
+
+// Moving gradient with a bright disc, so JPEG sizes look like a camera's rather than a flat frame's
+static cv::Mat SyntheticFrame(int width, int height, int t) {
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = frame.ptr<uint8_t>(y);
+        for (int x = 0; x < width; x++) {
+            row[x * 3] = uint8_t(x + t);
+            row[x * 3 + 1] = uint8_t(y + 2 * t);
+            row[x * 3 + 2] = uint8_t((x ^ y) + t);
+        }
+    }
+    cv::circle(frame, cv::Point((t * 7) % width, height / 2), height / 6, cv::Scalar(255, 255, 255), cv::FILLED);
+    return frame;
+}
+
+// A v2 pose packet as engine.py sends it
+static std::vector<uint8_t> PosePacket(uint64_t frame_id, int64_t capture_us, int64_t recv_us, uint16_t source_id, int keypoints) {
+    PoseHeader h{};
+    h.magic = kPoseMagic;
+    h.version = kPoseVersion;
+    h.header_size = sizeof(PoseHeader);
+    h.frame_id = frame_id;
+    h.capture_us = capture_us;
+    h.engine_recv_us = recv_us;
+    h.inference_us = WallClockMicros();
+    h.person_count = 1;
+    h.keypoint_count = (uint16_t)keypoints;
+    h.components = 4;
+    h.layout = POSE_LAYOUT_WORLD_XYZV;
+    h.source_id = source_id;
+    std::vector<uint8_t> out(sizeof(h) + size_t(keypoints) * 4 * sizeof(float));
+    std::memcpy(out.data(), &h, sizeof(h));
+    float* kp = reinterpret_cast<float*>(out.data() + sizeof(h));
+    for (int i = 0; i < keypoints * 4; i++) kp[i] = 0.01f * i;
+    return out;
+}
+
+// --- JSON output ---
+struct JsonWriter {
+    std::string text;
+    bool first = true;
+
+    void Key(const std::string& key) { text += (first ? "" : ",") + ("\"" + key + "\":"); first = false; }
+    void Open(const std::string& key, char bracket) { if (!key.empty()) Key(key); else { text += first ? "" : ","; } text += bracket; first = true; }
+    void Close(char bracket) { text += bracket; first = false; }
+    void Num(const std::string& key, double v) { Key(key); char b[32]; snprintf(b, sizeof(b), "%.3f", v); text += b; }
+    void Int(const std::string& key, int64_t v) { Key(key); text += std::to_string(v); }
+    void Str(const std::string& key, const std::string& v) { Key(key); text += "\"" + v + "\""; }
+    void Percentiles(const std::string& key, const LatencyHistogram::Snapshot& s) {
+        Open(key, '{');
+        Int("count", (int64_t)s.total);
+        for (auto [name, q] : { std::pair<const char*, double>{ "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p999", 0.999 } }) Int(name, s.Percentile(q));
+        Close('}');
+    }
+};
+
+// --- Micro-benchmarks ---
+// Runs `op` for opts.seconds after a short warm-up. Each call does `batch`
+// operations; per-call times (us) go into a histogram, so percentiles are only
+// meaningful for batch = 1.
+static void Bench(JsonWriter& json, const std::string& name, const std::string& params, int batch, const std::function<void()>& op) {
+    for (int i = 0; i < 3; i++) op();
+    LatencyHistogram hist;
+    uint64_t calls = 0;
+    Clock::time_point start = Clock::now(), end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opts.seconds));
+    Clock::time_point now = start;
+    while (now < end) {
+        Clock::time_point t0 = Clock::now();
+        op();
+        now = Clock::now();
+        hist.Record(std::chrono::duration_cast<std::chrono::microseconds>(now - t0).count());
+        calls++;
+    }
+    double elapsed = std::chrono::duration<double>(now - start).count();
+    double ops = double(calls) * batch;
+    LatencyHistogram::Snapshot s;
+    hist.Read(s);
+    json.Open("", '{');
+    json.Str("name", name);
+    json.Str("params", params);
+    json.Int("ops", (int64_t)ops);
+    json.Num("ns_per_op", elapsed * 1e9 / ops);
+    json.Num("ops_per_sec", ops / elapsed);
+    if (batch == 1) json.Percentiles("latency_us", s);
+    json.Close('}');
+    std::fprintf(stderr, "%-18s %-28s %12.0f ns/op\n", name.c_str(), params.c_str(), elapsed * 1e9 / ops);
+}
+
+static void JpegBenchmarks(JsonWriter& json) {
+    const cv::Size sizes[] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+    for (int b = 0; b < JPEG_BACKEND_COUNT; b++) {
+        if (!JpegBackendAvailable(JpegBackend(b))) continue;
+        std::unique_ptr<JpegCodec> codec = CreateJpegCodec(JpegBackend(b));
+        // CreateJpegCodec falls back to OpenCV when the backend fails to start; don't report that twice
+        if (codec->Backend() != JpegBackend(b)) continue;
+        for (const cv::Size& size : sizes) {
+            std::string params = std::string(kJpegBackendNames[b]) + " " + std::to_string(size.width) + "x" + std::to_string(size.height);
+            cv::Mat frame = SyntheticFrame(size.width, size.height, 0), decoded;
+            std::vector<uchar> jpeg;
+            Bench(json, "jpeg_encode", params, 1, [&] { codec->Encode(frame, 50, jpeg); });
+            Bench(json, "jpeg_decode", params + " " + std::to_string(jpeg.size() / 1024) + "KB", 1, [&] { codec->Decode(jpeg.data(), jpeg.size(), decoded); });
+        }
+    }
+}
+
+// The upload half of UpdateTexture. Needs a GL context; skipped without a display.
+static void TextureBenchmarks(JsonWriter& json) {
+#ifdef POSEBRIDGE_BENCH_GL
+    if (!glfwInit()) { std::fprintf(stderr, "texture_upload: no display, skipped\n"); return; }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    GLFWwindow* w = glfwCreateWindow(64, 64, "posebridge_bench", NULL, NULL);
+    if (!w) { glfwTerminate(); std::fprintf(stderr, "texture_upload: no GL context, skipped\n"); return; }
+    glfwMakeContextCurrent(w);
+    if (gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        for (cv::Size size : { cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080) }) {
+            std::string params = std::to_string(size.width) + "x" + std::to_string(size.height);
+            cv::Mat frame = SyntheticFrame(size.width, size.height, 0);
+            TextureStreamer tex;
+            uint64_t seq = 0;
+            // What the UI thread pays per frame, and the same with the DMA waited for
+            Bench(json, "texture_upload", params, 1, [&] { tex.Upload(frame, ++seq); });
+            Bench(json, "texture_upload", params + " +glFinish", 1, [&] { tex.Upload(frame, ++seq); glFinish(); });
+            tex.Release();
+        }
+    }
+    glfwDestroyWindow(w);
+    glfwTerminate();
+#else
+    (void)json;
+    std::fprintf(stderr, "texture_upload: built without the GUI, skipped\n");
+#endif
+}
+
+static void PoseBenchmarks(JsonWriter& json) {
+    // ReceiverThread's per-packet work: the summary's fields, then the binary packet mapped in place
+    std::vector<uint8_t> packet = PosePacket(1, WallClockMicros(), WallClockMicros(), 0, 33);
+    std::string meta = "{\"frame_id\":1,\"dropped\":0,\"roi_x\":120,\"roi_y\":40,\"roi_w\":300,\"roi_h\":400}";
+    volatile int64_t sink = 0;
+    const int batch = 1000;
+    Bench(json, "pose_parse", "33 keypoints + summary", batch, [&] {
+        for (int i = 0; i < batch; i++) {
+            PoseView view;
+            if (!ParsePosePacket(packet.data(), packet.size(), view)) continue;
+            sink = sink + JsonInt(meta, "dropped") + JsonInt(meta, "roi_x") + JsonInt(meta, "roi_y") + JsonInt(meta, "roi_w") + JsonInt(meta, "roi_h") + (int64_t)view.FloatCount();
+        }
+    });
+}
+
+// Compact sink: encode cost, plus bytes and worst error over a synthetic stream in
+// which the arms wave, the rest stands still and every keypoint has ~1 mm of jitter
+static void CompactBenchmarks(JsonWriter& json) {
+    const int frames = 300, keypoints = 33;
+    PoseHeader h{};
+    h.magic = kPoseMagic;
+    h.version = kPoseVersion;
+    h.header_size = sizeof(PoseHeader);
+    h.person_count = 1;
+    h.keypoint_count = keypoints;
+    h.components = 4;
+    h.layout = POSE_LAYOUT_WORLD_XYZV;
+    std::vector<std::vector<float>> stream(frames, std::vector<float>(keypoints * 4));
+    uint32_t rng = 1;
+    auto jitter = [&] { rng = rng * 1664525u + 1013904223u; return (float(rng >> 8) / float(1 << 24) - 0.5f) * 0.002f; };
+    for (int f = 0; f < frames; f++) {
+        for (int k = 0; k < keypoints; k++) {
+            float* p = stream[f].data() + k * 4;
+            bool arm = k >= 13 && k <= 22; // elbows, wrists, hands
+            float wave = arm ? 0.3f * std::sin(f * 0.1f + k) : 0.0f;
+            p[0] = 0.02f * k - 0.3f + wave + jitter();
+            p[1] = -0.05f * k + 0.8f + jitter();
+            p[2] = 0.01f * (k % 5) + (arm ? 0.5f * wave : 0.0f) + jitter();
+            p[3] = 0.9f + jitter();
+        }
+    }
+
+    PoseEncoder encoder;
+    PoseDecoder decoder;
+    encoder.SetParams(30, 2);
+    std::vector<uint8_t> packet;
+    int frame = 0;
+    Bench(json, "pose_compact_encode", "33 keypoints, keyframe 30", 1, [&] {
+        h.frame_id = frame;
+        encoder.Encode(h, stream[frame].data(), stream[frame].size(), packet);
+        frame = (frame + 1) % frames;
+    });
+
+    PoseEncoder fresh;
+    fresh.SetParams(30, 2);
+    size_t compact_bytes = 0, raw_bytes = 0;
+    float max_position_error = 0.0f;
+    PoseHeader decoded;
+    std::vector<float> out;
+    for (int f = 0; f < frames; f++) {
+        h.frame_id = f;
+        fresh.Encode(h, stream[f].data(), stream[f].size(), packet);
+        compact_bytes += packet.size();
+        raw_bytes += sizeof(PoseHeader) + stream[f].size() * sizeof(float);
+        if (decoder.Decode(packet.data(), packet.size(), decoded, out) != PoseDecoder::POSE_DECODED) continue;
+        for (int k = 0; k < keypoints; k++)
+            for (int c = 0; c < 3; c++) max_position_error = std::max(max_position_error, std::fabs(out[k * 4 + c] - stream[f][k * 4 + c]));
+    }
+    json.Open("", '{');
+    json.Str("name", "pose_compact_size");
+    json.Str("params", "33 keypoints, keyframe 30, deadband 2");
+    json.Num("raw_bytes_per_pose", double(raw_bytes) / frames);
+    json.Num("compact_bytes_per_pose", double(compact_bytes) / frames);
+    json.Num("ratio", double(raw_bytes) / compact_bytes);
+    json.Num("max_position_error_mm", max_position_error * 1000.0);
+    json.Close('}');
+    std::fprintf(stderr, "%-18s %-28s %8.1f B/pose (%.1fx), max error %.2f mm\n", "pose_compact_size", "33 keypoints", double(compact_bytes) / frames,
+        double(raw_bytes) / compact_bytes, max_position_error * 1000.0);
+}
+
+static void LogBenchmarks(JsonWriter& json) {
+    const std::string line = "[SYS] Camera 0 opened: 1280x720 @ 30 fps, MJPG (passthrough)";
+    for (int threads : { 1, 4 }) {
+        const int batch = 10000;
+        Bench(json, "log_push", std::to_string(threads) + " thread(s)", batch * threads, [&] {
+            std::vector<std::thread> pool;
+            for (int t = 1; t < threads; t++) pool.emplace_back([&] { for (int i = 0; i < batch; i++) app.Log(line); });
+            for (int i = 0; i < batch; i++) app.Log(line);
+            for (std::thread& t : pool) t.join();
+        });
+    }
+}
+
+// --- End to end ---
+// Synthetic source -> ExternalCaptureThread -> encode/publish -> mock engine ->
+// ReceiverThread, all over inproc sockets in the shared context.
+static const char* kBenchSourceEndpoint = "inproc://posebridge-bench-source";
+static const char* kBenchPoseEndpoint = "inproc://posebridge-bench-pose";
+
+static void SyntheticSourceThread(std::atomic<bool>& stop, std::atomic<uint64_t>& sent) {
+    zmq::socket_t pub(SharedZmqContext(), zmq::socket_type::pub);
+    pub.bind(kBenchSourceEndpoint);
+    // A short loop of pre-encoded frames keeps the generator off the profile
+    JpegCodecSlot codec;
+    std::vector<std::vector<uchar>> frames(16);
+    for (size_t i = 0; i < frames.size(); i++) codec.Get(DefaultJpegBackend()).Encode(SyntheticFrame(opts.e2e_width, opts.e2e_height, (int)i * 8), 80, frames[i]);
+    Clock::time_point next = Clock::now();
+    for (uint64_t i = 0; !stop; i++) {
+        const std::vector<uchar>& f = frames[i % frames.size()];
+        pub.send(zmq::buffer(f.data(), f.size()), zmq::send_flags::none);
+        sent++;
+        if (opts.e2e_fps > 0) { next += std::chrono::microseconds(1000000 / opts.e2e_fps); std::this_thread::sleep_until(next); }
+    }
+}
+
+// Stands in for engine.py: one 33-keypoint pose per frame, stamped like the real one
+static void MockEngineThread(std::atomic<bool>& stop) {
+    zmq::context_t& ctx = SharedZmqContext();
+    zmq::socket_t pub(ctx, zmq::socket_type::pub);
+    pub.bind(kBenchPoseEndpoint);
+    zmq::socket_t sub(ctx, zmq::socket_type::sub);
+    sub.connect(kInprocFramesEndpoint);
+    sub.set(zmq::sockopt::subscribe, "");
+    zmq::pollitem_t item{ sub, 0, ZMQ_POLLIN, 0 };
+    std::vector<zmq::message_t> msgs;
+    while (!stop) {
+        zmq::poll(&item, 1, std::chrono::milliseconds(50));
+        while (zmq::recv_multipart(sub, std::back_inserter(msgs), zmq::recv_flags::dontwait)) {
+            // [topic, meta, payload]; group "sync" messages carry no frame
+            if (msgs.size() == 3 && std::string_view(static_cast<const char*>(msgs[0].data()), msgs[0].size()) != "sync") {
+                int64_t recv_us = WallClockMicros();
+                std::string_view meta(static_cast<const char*>(msgs[1].data()), msgs[1].size());
+                std::vector<uint8_t> packet = PosePacket((uint64_t)JsonInt(meta, "frame_id"), JsonInt(meta, "capture_us"), recv_us, (uint16_t)JsonInt(meta, "cam"), 33);
+                pub.send(zmq::str_buffer("{\"dropped\":0}"), zmq::send_flags::sndmore);
+                pub.send(zmq::buffer(packet.data(), packet.size()), zmq::send_flags::none);
+            }
+            msgs.clear();
+        }
+    }
+}
+
+static void EndToEnd(JsonWriter& json) {
+    app.source_mode = SOURCE_EXTERNAL_ZMQ;
+    app.external_zmq_addr = kBenchSourceEndpoint;
+    app.engine_kind = ENGINE_PYTHON;
+    app.pose_endpoint = kBenchPoseEndpoint;
+    app.frames_endpoint.clear();
+    app.preview_endpoint.clear();
+
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> sent{ 0 };
+    std::thread engine(MockEngineThread, std::ref(stop));
+    std::thread camera(CameraThread), receiver(ReceiverThread);
+    std::thread source(SyntheticSourceThread, std::ref(stop), std::ref(sent));
+    app.camera_active = true;
+
+    // Warm-up, then everything is measured as the difference of two snapshots
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    LatencyHistogram::Snapshot before[STAGE_COUNT], after;
+    for (int i = 0; i < STAGE_COUNT; i++) app.latency[i].Read(before[i]);
+    uint64_t sent0 = sent, frames0 = app.count_cam_frames, poses0 = app.count_pose_packets;
+    uint64_t dropped0[CHANNEL_COUNT];
+    for (int c = 0; c < CHANNEL_COUNT; c++) dropped0[c] = app.dropped[c];
+    Clock::time_point t0 = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opts.e2e_seconds));
+    double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    json.Open("end_to_end", '{');
+    json.Str("resolution", std::to_string(opts.e2e_width) + "x" + std::to_string(opts.e2e_height));
+    json.Int("source_fps", opts.e2e_fps);
+    json.Str("jpeg_codec", kJpegBackendNames[app.jpeg_backend]);
+    json.Num("seconds", elapsed);
+    json.Num("source_per_sec", (sent - sent0) / elapsed);
+    json.Num("frames_per_sec", (app.count_cam_frames - frames0) / elapsed);
+    json.Num("poses_per_sec", (app.count_pose_packets - poses0) / elapsed);
+    json.Open("dropped", '{');
+    for (int c = 0; c < CHANNEL_COUNT; c++) json.Int(kChannelNames[c], (int64_t)(app.dropped[c] - dropped0[c]));
+    json.Close('}');
+    json.Open("latency_us", '{');
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        app.latency[i].Read(after);
+        LatencyHistogram::Snapshot window = after.Since(before[i]);
+        if (window.total) json.Percentiles(kStageNames[i], window);
+    }
+    json.Close('}');
+    json.Close('}');
+    std::fprintf(stderr, "end_to_end         %.1f poses/s, p50 %lld us\n", (app.count_pose_packets - poses0) / elapsed, (long long)after.Since(before[STAGE_END_TO_END]).Percentile(0.5));
+
+    app.camera_active = false;
+    stop = true;
+    app.is_running = false;
+    source.join(); camera.join(); receiver.join(); engine.join();
+}
+
+static bool ApplyBenchOption(const std::string& key, const std::string& value) {
+    try {
+        if (key == "seconds") { opts.seconds = std::stod(value); return opts.seconds > 0; }
+        if (key == "e2e_seconds") { opts.e2e_seconds = std::stod(value); return opts.e2e_seconds > 0; }
+        if (key == "e2e_fps") { opts.e2e_fps = std::stoi(value); return opts.e2e_fps >= 0; }
+        if (key == "e2e_resolution") return sscanf(value.c_str(), "%dx%d", &opts.e2e_width, &opts.e2e_height) == 2 && opts.e2e_width > 0 && opts.e2e_height > 0;
+    }
+    catch (...) { return false; }
+    if (key == "micro") return ParseBool(value, opts.micro);
+    if (key == "e2e") return ParseBool(value, opts.e2e);
+    if (key == "out") { opts.out = value; return true; }
+    return false;
+}
+
+static void PrintUsage() {
+    std::puts(
+        "Usage: posebridge_bench [--key value]...\n"
+        "  --seconds X             time per micro-benchmark (default 1)\n"
+        "  --micro on|off          JPEG, texture upload, pose parsing and logging benchmarks (default on)\n"
+        "  --e2e on|off            end-to-end run against a mock engine (default on)\n"
+        "  --e2e_seconds X         measured part of the end-to-end run (default 5)\n"
+        "  --e2e_fps N             synthetic source rate, 0 = as fast as possible (default 60)\n"
+        "  --e2e_resolution WxH    synthetic frame size (default 640x480)\n"
+        "  --out FILE              write the JSON here instead of stdout\n"
+        "Pipeline settings (e.g. --jpeg_codec opencv, --frames_policy lossless) apply to the end-to-end run.");
+}
+
+int main(int argc, char** argv) {
+    ConfigEntries entries;
+    if (!ParseCommandLine(argc, argv, entries)) { PrintUsage(); return 1; }
+    for (const auto& [key, value] : entries) {
+        if (key == "help") { PrintUsage(); return 0; }
+        if (!ApplyBenchOption(key, value) && !ApplySetting(key, value)) { std::fprintf(stderr, "Bad setting: %s = %s\n", key.c_str(), value.c_str()); return 1; }
+    }
+
+    JsonWriter json;
+    json.Open("", '{');
+    json.Int("version", 1);
+    json.Int("timestamp_us", WallClockMicros());
+    json.Int("hardware_threads", std::thread::hardware_concurrency());
+    if (opts.micro) {
+        json.Open("micro", '[');
+        JpegBenchmarks(json);
+        TextureBenchmarks(json);
+        PoseBenchmarks(json);
+        CompactBenchmarks(json);
+        LogBenchmarks(json);
+        json.Close(']');
+    }
+    // Last: it stops the pipeline threads for good
+    if (opts.e2e) EndToEnd(json);
+    json.Close('}');
+
+    if (opts.out.empty()) { std::puts(json.text.c_str()); return 0; }
+    FILE* f = std::fopen(opts.out.c_str(), "w");
+    if (!f) { std::fprintf(stderr, "Cannot write %s\n", opts.out.c_str()); return 1; }
+    std::fputs(json.text.c_str(), f);
+    std::fputc('\n', f);
+    std::fclose(f);
+    return 0;
+}
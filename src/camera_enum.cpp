@@ -0,0 +1,278 @@
+#include "camera_enum.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "app_state.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <wrl/client.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#else
+#include <opencv2/videoio.hpp>
+#endif
+
+static const char* kCameraCacheFile = "posebridge_cameras.cache";
+
+static std::string FourccString(uint32_t cc) {
+    char s[5] = { char(cc & 0xFF), char((cc >> 8) & 0xFF), char((cc >> 16) & 0xFF), char((cc >> 24) & 0xFF), 0 };
+    for (int i = 0; i < 4; i++) if (s[i] < 32 || s[i] > 126) return std::to_string(cc); // not a FOURCC, e.g. MFVideoFormat_RGB24
+    return s;
+}
+
+#if defined(_WIN32)
+// --- Media Foundation ---
+using Microsoft::WRL::ComPtr;
+
+// Activating a source is the slow part (up to seconds per device), so each
+// device gets its own thread and COM apartment; the source is recreated there
+// from its symbolic link rather than marshalling the IMFActivate.
+static void ProbeMfModes(CameraInfo& info) {
+    HRESULT co = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    MFStartup(MF_VERSION, MFSTARTUP_LITE);
+    {
+        ComPtr<IMFAttributes> attr;
+        ComPtr<IMFMediaSource> source;
+        std::wstring link(info.path.begin(), info.path.end());
+        if (SUCCEEDED(MFCreateAttributes(&attr, 2)) &&
+            SUCCEEDED(attr->SetGUID(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE, MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID)) &&
+            SUCCEEDED(attr->SetString(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_SYMBOLIC_LINK, link.c_str())) &&
+            SUCCEEDED(MFCreateDeviceSource(attr.Get(), &source))) {
+            ComPtr<IMFPresentationDescriptor> pd;
+            ComPtr<IMFStreamDescriptor> sd;
+            ComPtr<IMFMediaTypeHandler> handler;
+            BOOL selected;
+            DWORD types = 0;
+            if (SUCCEEDED(source->CreatePresentationDescriptor(&pd)) && SUCCEEDED(pd->GetStreamDescriptorByIndex(0, &selected, &sd)) &&
+                SUCCEEDED(sd->GetMediaTypeHandler(&handler)) && SUCCEEDED(handler->GetMediaTypeCount(&types))) {
+                for (DWORD i = 0; i < types; i++) {
+                    ComPtr<IMFMediaType> type;
+                    if (FAILED(handler->GetMediaTypeByIndex(i, &type))) continue;
+                    UINT32 w = 0, h = 0, num = 0, den = 0;
+                    GUID subtype{};
+                    if (FAILED(MFGetAttributeSize(type.Get(), MF_MT_FRAME_SIZE, &w, &h)) || FAILED(type->GetGUID(MF_MT_SUBTYPE, &subtype))) continue;
+                    MFGetAttributeRatio(type.Get(), MF_MT_FRAME_RATE, &num, &den);
+                    info.modes.push_back(CameraMode{ (int)w, (int)h, den ? (float)num / den : 0.0f, FourccString(subtype.Data1) });
+                }
+            }
+            source->Shutdown();
+        }
+    }
+    MFShutdown();
+    if (SUCCEEDED(co)) CoUninitialize();
+}
+
+static std::string Narrow(const wchar_t* s) {
+    int n = WideCharToMultiByte(CP_UTF8, 0, s, -1, nullptr, 0, nullptr, nullptr);
+    std::string out(n > 0 ? n - 1 : 0, '\0');
+    if (n > 1) WideCharToMultiByte(CP_UTF8, 0, s, -1, out.data(), n, nullptr, nullptr);
+    return out;
+}
+
+std::vector<CameraInfo> EnumerateCameras() {
+    std::vector<CameraInfo> cams;
+    HRESULT co = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    MFStartup(MF_VERSION, MFSTARTUP_LITE);
+    ComPtr<IMFAttributes> attr;
+    IMFActivate** devices = nullptr;
+    UINT32 count = 0;
+    // Same enumeration the OpenCV MSMF backend uses, so positions are capture indices
+    if (SUCCEEDED(MFCreateAttributes(&attr, 1)) &&
+        SUCCEEDED(attr->SetGUID(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE, MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID)) &&
+        SUCCEEDED(MFEnumDeviceSources(attr.Get(), &devices, &count))) {
+        for (UINT32 i = 0; i < count; i++) {
+            CameraInfo info;
+            info.index = (int)i;
+            WCHAR* str = nullptr;
+            UINT32 len = 0;
+            if (SUCCEEDED(devices[i]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &str, &len))) { info.name = Narrow(str); CoTaskMemFree(str); }
+            if (SUCCEEDED(devices[i]->GetAllocatedString(MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_SYMBOLIC_LINK, &str, &len))) { info.path = Narrow(str); CoTaskMemFree(str); }
+            devices[i]->Release();
+            cams.push_back(std::move(info));
+        }
+        CoTaskMemFree(devices);
+    }
+    MFShutdown();
+    if (SUCCEEDED(co)) CoUninitialize();
+
+    std::vector<std::thread> probes;
+    for (CameraInfo& info : cams) if (!info.path.empty()) probes.emplace_back(ProbeMfModes, std::ref(info));
+    for (std::thread& t : probes) t.join();
+    return cams;
+}
+
+#elif defined(__linux__)
+// --- V4L2 ---
+static bool Xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do r = ioctl(fd, request, arg); while (r == -1 && errno == EINTR);
+    return r == 0;
+}
+
+// Index -1 if the node is not a capture device (UVC cameras also expose a metadata node)
+static CameraInfo ProbeV4l2(int index, const std::string& path) {
+    CameraInfo info;
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) return info;
+    v4l2_capability cap{};
+    uint32_t caps = 0;
+    if (Xioctl(fd, VIDIOC_QUERYCAP, &cap)) caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE)) { close(fd); return info; }
+    info.index = index;
+    info.path = path;
+    info.name = reinterpret_cast<const char*>(cap.card);
+    v4l2_fmtdesc fmt{};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (fmt.index = 0; Xioctl(fd, VIDIOC_ENUM_FMT, &fmt); fmt.index++) {
+        std::string cc = FourccString(fmt.pixelformat);
+        v4l2_frmsizeenum size{};
+        size.pixel_format = fmt.pixelformat;
+        for (size.index = 0; Xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size); size.index++) {
+            if (size.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+                // Continuous / stepwise range: the largest size stands in for it
+                info.modes.push_back(CameraMode{ (int)size.stepwise.max_width, (int)size.stepwise.max_height, 0.0f, cc });
+                break;
+            }
+            v4l2_frmivalenum ival{};
+            ival.pixel_format = fmt.pixelformat;
+            ival.width = size.discrete.width;
+            ival.height = size.discrete.height;
+            size_t before = info.modes.size();
+            for (ival.index = 0; Xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) && ival.type == V4L2_FRMIVAL_TYPE_DISCRETE; ival.index++) {
+                if (ival.discrete.numerator) info.modes.push_back(CameraMode{ (int)ival.width, (int)ival.height, (float)ival.discrete.denominator / ival.discrete.numerator, cc });
+            }
+            if (info.modes.size() == before) info.modes.push_back(CameraMode{ (int)ival.width, (int)ival.height, 0.0f, cc });
+        }
+    }
+    close(fd);
+    return info;
+}
+
+std::vector<CameraInfo> EnumerateCameras() {
+    // /dev/videoN is what cv::VideoCapture(N) opens with the V4L2 backend
+    std::vector<int> nodes;
+    if (DIR* dir = opendir("/dev")) {
+        while (dirent* e = readdir(dir)) {
+            int n;
+            char tail;
+            if (std::sscanf(e->d_name, "video%d%c", &n, &tail) == 1 && n >= 0) nodes.push_back(n);
+        }
+        closedir(dir);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    std::vector<std::future<CameraInfo>> probes;
+    for (int n : nodes) probes.push_back(std::async(std::launch::async, ProbeV4l2, n, "/dev/video" + std::to_string(n)));
+    std::vector<CameraInfo> cams;
+    for (auto& p : probes) { CameraInfo info = p.get(); if (info.index >= 0) cams.push_back(std::move(info)); }
+    return cams;
+}
+
+#else
+// --- Other platforms: parallel opens of the first indices ---
+static CameraInfo ProbeOpen(int index) {
+    CameraInfo info;
+    cv::VideoCapture cap(index);
+    if (!cap.isOpened()) return info;
+    info.index = index;
+    info.name = "Camera " + std::to_string(index);
+    info.modes.push_back(CameraMode{ (int)cap.get(cv::CAP_PROP_FRAME_WIDTH), (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT), (float)cap.get(cv::CAP_PROP_FPS), "" });
+    return info;
+}
+
+std::vector<CameraInfo> EnumerateCameras() {
+    std::vector<std::future<CameraInfo>> probes;
+    for (int i = 0; i < kMaxSources; i++) probes.push_back(std::async(std::launch::async, ProbeOpen, i));
+    std::vector<CameraInfo> cams;
+    for (auto& p : probes) { CameraInfo info = p.get(); if (info.index >= 0) cams.push_back(std::move(info)); }
+    return cams;
+}
+#endif
+
+// --- Cache ---
+// One camera per line: index \t name \t path \t WxH@fps:FOURCC;...
+
+bool SaveCameraCache(const std::string& path, const std::vector<CameraInfo>& cameras) {
+    std::ofstream out(path);
+    if (!out) return false;
+    for (const CameraInfo& c : cameras) {
+        out << c.index << '\t' << c.name << '\t' << c.path << '\t';
+        for (size_t i = 0; i < c.modes.size(); i++) out << (i ? ";" : "") << c.modes[i].width << 'x' << c.modes[i].height << '@' << c.modes[i].fps << ':' << c.modes[i].fourcc;
+        out << '\n';
+    }
+    return bool(out);
+}
+
+bool LoadCameraCache(const std::string& path, std::vector<CameraInfo>& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    out.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string index, modes;
+        CameraInfo c;
+        if (!std::getline(fields, index, '\t') || !std::getline(fields, c.name, '\t') || !std::getline(fields, c.path, '\t')) continue;
+        std::getline(fields, modes);
+        try { c.index = std::stoi(index); }
+        catch (...) { continue; }
+        std::istringstream list(modes);
+        std::string m;
+        while (std::getline(list, m, ';')) {
+            CameraMode mode;
+            char cc[16] = {};
+            if (std::sscanf(m.c_str(), "%dx%d@%f:%15s", &mode.width, &mode.height, &mode.fps, cc) >= 3) { mode.fourcc = cc; c.modes.push_back(mode); }
+        }
+        out.push_back(std::move(c));
+    }
+    return true;
+}
+
+// --- Background scan ---
+static std::mutex g_scan_mutex;
+static std::thread g_scan;
+
+static void ScanThread() {
+    std::vector<CameraInfo> found = EnumerateCameras();
+    {
+        std::lock_guard<std::mutex> lock(app.cams_mutex);
+        app.cameras = found;
+    }
+    if (!SaveCameraCache(kCameraCacheFile, found)) app.Log("[ERR] Cannot write camera cache: " + std::string(kCameraCacheFile));
+    if (found.empty()) app.Log("No cameras found.");
+    else app.Log("Found " + std::to_string(found.size()) + " cameras.");
+    app.cams_scanning = false;
+}
+
+void RefreshCameraList() {
+    std::lock_guard<std::mutex> lock(g_scan_mutex);
+    if (app.cams_scanning) return;
+    if (g_scan.joinable()) g_scan.join();
+    {
+        std::lock_guard<std::mutex> cams_lock(app.cams_mutex);
+        std::vector<CameraInfo> cached;
+        if (app.cameras.empty() && LoadCameraCache(kCameraCacheFile, cached)) app.cameras = std::move(cached);
+    }
+    app.Log("Scanning cameras...");
+    app.cams_scanning = true;
+    g_scan = std::thread(ScanThread);
+}
+
+void WaitCameraScan() {
+    std::lock_guard<std::mutex> lock(g_scan_mutex);
+    if (g_scan.joinable()) g_scan.join();
+}
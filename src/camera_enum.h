@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Local camera discovery through the platform's device APIs (V4L2 on Linux,
+// Media Foundation on Windows) rather than blind cv::VideoCapture opens.
+// Devices are probed in parallel on a background thread, and the last result
+// is cached on disk so the list is there immediately at the next start.
+
+struct CameraMode {
+    int width = 0;
+    int height = 0;
+    float fps = 0.0f;   // 0 if the device does not say
+    std::string fourcc; // "MJPG", "YUYV", ...
+};
+
+struct CameraInfo {
+    int index = -1;   // cv::VideoCapture index
+    std::string name;
+    std::string path; // /dev/videoN or the Media Foundation symbolic link
+    std::vector<CameraMode> modes;
+};
+
+// Blocking probe of every device, each on its own thread
+std::vector<CameraInfo> EnumerateCameras();
+
+bool LoadCameraCache(const std::string& path, std::vector<CameraInfo>& out);
+bool SaveCameraCache(const std::string& path, const std::vector<CameraInfo>& cameras);
+
+// Shows the cached list at once, then rescans in the background and updates
+// app.cameras when done. A call while a scan is running is ignored.
+void RefreshCameraList();
+// Joins a running scan; call before exit
+void WaitCameraScan();
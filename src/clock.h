@@ -0,0 +1,9 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Wall-clock microseconds since the Unix epoch. Used for timestamps that cross
+// the process boundary, since engine.py stamps with time.time_ns() // 1000.
+inline int64_t WallClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,343 @@
+#include "config.h"
+
+#include <fstream>
+
+#include "app_state.h"
+
+static std::string Trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static bool ParseInt(const std::string& value, int& out) {
+    try { size_t n; out = std::stoi(value, &n); return n == value.size(); }
+    catch (...) { return false; }
+}
+
+static bool ParseFloat(const std::string& value, float& out) {
+    try { size_t n; out = std::stof(value, &n); return n == value.size(); }
+    catch (...) { return false; }
+}
+
+// Comma-separated non-negative integers below `limit`
+static bool ParseIntList(const std::string& value, int limit, std::vector<int>& out) {
+    out.clear();
+    size_t b = 0;
+    while (b <= value.size()) {
+        size_t e = value.find(',', b);
+        if (e == std::string::npos) e = value.size();
+        int v;
+        if (!ParseInt(Trim(value.substr(b, e - b)), v) || v < 0 || v >= limit) return false;
+        out.push_back(v);
+        b = e + 1;
+    }
+    return true;
+}
+
+static bool EndsWith(const std::string& s, const std::string& suffix) {
+    return s.size() > suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Index of `value` in a name table, or -1
+static int ParseName(const std::string& value, const char* const* names, int count) {
+    for (int i = 0; i < count; i++) if (value == names[i]) return i;
+    return -1;
+}
+
+// resolution = WxH, fps = N, fourcc = XXXX | default
+static bool ApplyFormatField(const std::string& field, const std::string& value, CaptureFormat& fmt) {
+    if (field == "resolution") {
+        size_t x = value.find('x');
+        return x != std::string::npos && ParseInt(value.substr(0, x), fmt.width) && ParseInt(value.substr(x + 1), fmt.height) && fmt.width > 0 && fmt.height > 0;
+    }
+    if (field == "fps") return ParseInt(value, fmt.fps) && fmt.fps >= 0;
+    if (field == "fourcc") {
+        if (value == "default") { fmt.fourcc.clear(); return true; }
+        if (value.size() != 4) return false;
+        fmt.fourcc = value;
+        return true;
+    }
+    return false;
+}
+
+bool ParseBool(const std::string& value, bool& out) {
+    if (value == "1" || value == "on" || value == "true" || value == "yes") { out = true; return true; }
+    if (value == "0" || value == "off" || value == "false" || value == "no") { out = false; return true; }
+    return false;
+}
+
+bool LoadConfigFile(const std::string& path, ConfigEntries& out) {
+    std::ifstream in(path);
+    if (!in) { app.Log("[ERR] Cannot read config: " + path); return false; }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) { app.Log("[ERR] " + path + ":" + std::to_string(line_no) + ": expected key = value"); return false; }
+        out.emplace_back(Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)));
+    }
+    return true;
+}
+
+bool ParseCommandLine(int argc, char** argv, ConfigEntries& out) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) { app.Log("[ERR] Unexpected argument: " + arg); return false; }
+        std::string key = arg.substr(2), value;
+        size_t eq = key.find('=');
+        if (eq != std::string::npos) { value = key.substr(eq + 1); key.erase(eq); }
+        else if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) value = argv[++i];
+        else value = "on";
+        if (key == "config") { if (!LoadConfigFile(value, out)) return false; }
+        else out.emplace_back(key, value);
+    }
+    return true;
+}
+
+bool ApplySetting(const std::string& key, const std::string& value) {
+    if (key == "source") {
+        if (value == "cam") app.source_mode = SOURCE_LOCAL_CAM;
+        else if (value == "zmq") app.source_mode = SOURCE_EXTERNAL_ZMQ;
+        else if (value == "replay") app.source_mode = SOURCE_REPLAY;
+        else return false;
+    }
+    else if (key == "cam") {
+        // Comma-separated device indices, captured concurrently
+        std::vector<int> cams;
+        if (!ParseIntList(value, kMaxSources, cams)) return false;
+        app.SetSelectedCams(cams);
+    }
+    else if (key == "resolution" || key == "fps" || key == "fourcc") {
+        // Every camera; camN_<field> below overrides one
+        CaptureFormat fmt = app.CameraFormat(0);
+        if (!ApplyFormatField(key, value, fmt)) return false;
+        std::lock_guard<std::mutex> lock(app.cams_mutex);
+        for (CaptureFormat& f : app.cam_formats) ApplyFormatField(key, value, f);
+        app.formats_generation++;
+    }
+    else if (key.rfind("cam", 0) == 0 && key.find('_') != std::string::npos && key.find('_') > 3) {
+        size_t us = key.find('_');
+        int cam;
+        if (!ParseInt(key.substr(3, us - 3), cam) || cam < 0 || cam >= kMaxSources) return false;
+        CaptureFormat fmt = app.CameraFormat(cam);
+        if (!ApplyFormatField(key.substr(us + 1), value, fmt)) return false;
+        app.SetCameraFormat(cam, fmt);
+    }
+    else if (key == "mjpeg_passthrough") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.mjpeg_passthrough = on;
+        app.formats_generation++;
+    }
+    else if (key == "sync_tolerance_ms") {
+        int ms;
+        if (!ParseInt(value, ms) || ms < 0) return false;
+        app.sync_tolerance_us = int64_t(ms) * 1000;
+    }
+    else if (key == "roi") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.roi.enabled = on;
+    }
+    else if (key == "roi_padding") {
+        float v;
+        if (!ParseFloat(value, v) || v < 0.0f) return false;
+        app.roi.padding = v;
+    }
+    else if (key == "roi_keyframe_interval" || key == "roi_min_size") {
+        int v;
+        if (!ParseInt(value, v) || v < 0) return false;
+        (key == "roi_min_size" ? app.roi.min_size : app.roi.keyframe_interval) = v;
+    }
+    else if (key == "zmq_addr") app.external_zmq_addr = value;
+    else if (key == "replay") app.replay_path = value;
+    else if (key == "replay_speed") {
+        float v;
+        if (!ParseFloat(value, v) || v < 0.0f) return false;
+        app.replay_speed = v;
+    }
+    else if (key == "replay_loop") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.replay_loop = on;
+    }
+    else if (key == "record") {
+        // record = <file> starts a new recording, record = off finishes it
+        if (value == "off" || value.empty()) { app.recorder.Close(); return true; }
+        if (!app.recorder.Open(value)) { app.Log("[ERR] Cannot write recording: " + value); return false; }
+        app.Log("[SYS] Recording to " + value);
+    }
+    // Endpoints and the ZMQ context are read when the threads start
+    else if (key == "frames_endpoint") app.frames_endpoint = value;
+    else if (key == "preview_endpoint") app.preview_endpoint = value;
+    else if (key == "pose_endpoint") app.pose_endpoint = value;
+    else if (key == "control_endpoint") app.control_endpoint = value;
+    else if (key == "engine_ipc") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.engine_ipc = on;
+    }
+    else if (key == "zmq_io_threads") {
+        int v;
+        if (!ParseInt(value, v) || v < 1) return false;
+        app.zmq_io_threads = v;
+    }
+    else if (key == "zmq_io_cpus") {
+        if (value == "none") app.zmq_io_cpus.clear();
+        else if (!ParseIntList(value, 1024, app.zmq_io_cpus)) return false;
+    }
+    else if (EndsWith(key, "_cpus") || EndsWith(key, "_priority")) {
+        // <role>_cpus = 2,3 | none, <role>_priority = normal | high | realtime; role "engine" = engine.py
+        bool is_cpus = key.back() == 's';
+        std::string name = key.substr(0, key.size() - (is_cpus ? 5 : 9));
+        int role = name == "engine" ? -1 : ParseName(name, kThreadRoleNames, THREAD_ROLE_COUNT);
+        if (role < 0 && name != "engine") return false;
+        ThreadTuning t = app.Tuning(role);
+        if (is_cpus) {
+            if (value == "none" || value == "any") t.cpus.clear();
+            else if (!ParseIntList(value, 1024, t.cpus)) return false;
+        }
+        else {
+            int p = ParseName(value, kThreadPriorityNames, THREAD_PRIORITY_COUNT);
+            if (p < 0) return false;
+            t.priority = ThreadPriority(p);
+        }
+        app.SetTuning(role, t);
+    }
+    else if (key == "transport") {
+        if (value == "jpeg") app.frame_transport = TRANSPORT_JPEG;
+        else if (value == "shm") app.frame_transport = TRANSPORT_SHM;
+        else return false;
+    }
+    else if (key == "jpeg_codec") {
+        int i = ParseName(value, kJpegBackendNames, JPEG_BACKEND_COUNT);
+        if (i < 0) return false;
+        if (!JpegBackendAvailable(JpegBackend(i))) { app.Log("[ERR] JPEG codec " + value + " is not built in."); return false; }
+        app.jpeg_backend = JpegBackend(i);
+    }
+    else if (key.size() > 7 && (key.compare(key.size() - 7, 7, "_policy") == 0 || key.compare(key.size() - 6, 6, "_depth") == 0)) {
+        // <channel>_policy = conflate | drop_oldest | lossless, <channel>_depth = N
+        bool is_policy = key.back() == 'y';
+        int c = ParseName(key.substr(0, key.size() - (is_policy ? 7 : 6)), kChannelNames, CHANNEL_COUNT);
+        if (c < 0) return false;
+        if (is_policy) {
+            int p = ParseName(value, kDeliveryPolicyNames, DELIVERY_POLICY_COUNT);
+            if (p < 0) return false;
+            app.delivery[c].policy = DeliveryPolicy(p);
+        }
+        else {
+            int depth;
+            if (!ParseInt(value, depth) || depth < 1) return false;
+            app.delivery[c].depth = depth;
+        }
+    }
+    else if (key == "compact_keyframe_interval" || key == "compact_deadband") {
+        int v;
+        if (!ParseInt(value, v) || v < (key == "compact_deadband" ? 0 : 1)) return false;
+        (key == "compact_deadband" ? app.compact_deadband : app.compact_keyframe_interval) = v;
+    }
+    else if (key.rfind("output_", 0) == 0) {
+        // output_<sink> = on|off, output_<sink>_target = shm name | topic | host:port
+        bool is_target = key.size() > 14 && key.compare(key.size() - 7, 7, "_target") == 0;
+        int k = ParseName(key.substr(7, key.size() - 7 - (is_target ? 7 : 0)), kPoseSinkNames, SINK_COUNT);
+        if (k < 0) return false;
+        if (is_target) { if (value.empty()) return false; app.outputs.SetTarget(PoseSinkKind(k), value); }
+        else {
+            bool on;
+            if (!ParseBool(value, on)) return false;
+            if (on && !PoseSinkAvailable(PoseSinkKind(k))) { app.Log("[ERR] Output " + key.substr(7) + " is not built in."); return false; }
+            app.outputs.SetEnabled(PoseSinkKind(k), on);
+        }
+    }
+    else if (key == "pose_filter") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.pose_filters.enabled = on;
+    }
+    else if (key == "filter_min_cutoff" || key == "filter_beta" || key == "filter_d_cutoff") {
+        float v;
+        if (!ParseFloat(value, v) || v < 0.0f || (v == 0.0f && key != "filter_beta")) return false;
+        PoseFilterParams p = app.pose_filters.Params();
+        (key == "filter_min_cutoff" ? p.min_cutoff : key == "filter_beta" ? p.beta : p.d_cutoff) = v;
+        app.pose_filters.SetParams(p);
+    }
+    else if (key == "predict_lead_ms" || key == "predict_max_ms") {
+        float ms;
+        if (!ParseFloat(value, ms) || ms < 0.0f) return false;
+        if (key == "predict_lead_ms") app.pose_filters.lead_us = int64_t(ms * 1000.0f);
+        else { PoseFilterParams p = app.pose_filters.Params(); p.max_predict_us = int64_t(ms * 1000.0f); app.pose_filters.SetParams(p); }
+    }
+    else if (key == "shm_slots") {
+        int v;
+        if (!ParseInt(value, v) || v < 1) return false;
+        app.shm_slots = v;
+    }
+    else if (key == "script") app.python_script = value;
+    else if (key == "engine_backend") {
+        if (value == "python") app.engine_kind = ENGINE_PYTHON;
+        else if (value == "native") app.engine_kind = ENGINE_NATIVE;
+        else return false;
+    }
+    else if (key == "model") app.native_engine.model_path = value;
+    else if (key == "model_format") {
+        int f = ParseName(value, kModelFormatNames, 2);
+        if (f < 0) return false;
+        app.native_engine.format = PoseModelFormat(f);
+    }
+    else if (key == "provider") {
+        int p = ParseName(value, kProviderNames, PROVIDER_COUNT);
+        if (p < 0) return false;
+        app.native_engine.provider = InferenceProvider(p);
+    }
+    else if (key == "preprocess") {
+        int d = ParseName(value, kPreprocessNames, PREPROCESS_DEVICE_COUNT);
+        if (d < 0) return false;
+        app.native_engine.preprocess = PreprocessDevice(d);
+    }
+    else if (key == "min_score") {
+        float v;
+        if (!ParseFloat(value, v)) return false;
+        app.native_engine.min_score = v;
+    }
+    else if (key == "batch_max") {
+        int v;
+        if (!ParseInt(value, v) || v < 1) return false;
+        app.native_engine.max_batch = v;
+    }
+    else if (key == "batch_delay_us" || key == "stale_ms") {
+        int v;
+        if (!ParseInt(value, v) || v < 0) return false;
+        if (key == "batch_delay_us") app.native_engine.max_delay_us = v;
+        else app.native_engine.stale_us = int64_t(v) * 1000;
+    }
+    else if (key == "engine_threads") {
+        int v;
+        if (!ParseInt(value, v) || v < 0) return false;
+        app.native_engine.threads = v;
+    }
+    else if (key == "previews") return ParseBool(value, app.show_previews);
+    else if (key == "engine_preview") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.engine_preview = on;
+    }
+    else if (key == "engine_standby") {
+        bool on;
+        if (!ParseBool(value, on)) return false;
+        app.engine_standby = on;
+    }
+    else if (key == "engine_heartbeat_ms") {
+        int v;
+        if (!ParseInt(value, v) || v < 50) return false;
+        app.engine_heartbeat_ms = v;
+    }
+    else return false;
+    return true;
+}
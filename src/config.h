@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+// Settings as ordered key/value pairs, from `key = value` files and
+// --key value / --key=value flags. Later entries override earlier ones.
+using ConfigEntries = std::vector<std::pair<std::string, std::string>>;
+
+// Reads `key = value` lines; '#' starts a comment. Returns false if the file can't be read.
+bool LoadConfigFile(const std::string& path, ConfigEntries& out);
+
+// Collects flags in order. --config <path> is expanded in place, so flags after
+// it override the file. A flag without a value (e.g. --engine) means "on".
+bool ParseCommandLine(int argc, char** argv, ConfigEntries& out);
+
+// Applies one pipeline setting to `app`. Returns false for unknown keys or bad values.
+bool ApplySetting(const std::string& key, const std::string& value);
+
+bool ParseBool(const std::string& value, bool& out);
@@ -0,0 +1,53 @@
+#include "delivery.h"
+
+#include <iterator>
+
+#include <zmq_addon.hpp>
+
+const char* kDeliveryPolicyNames[DELIVERY_POLICY_COUNT] = { "conflate", "drop_oldest", "lossless" };
+const char* kChannelNames[CHANNEL_COUNT] = { "frames", "preview", "pose", "external" };
+
+// libzmq counts whole multipart messages against the HWM; 0 means unlimited.
+// One spare per stream, so a message arriving mid-drain is not lost.
+static int Hwm(const ChannelPolicy& policy) {
+    if (policy.policy == DELIVERY_LOSSLESS) return 0;
+    return ((int)policy.Limit() + 1) * kMaxChannelStreams;
+}
+
+void ApplySendPolicy(zmq::socket_t& socket, const ChannelPolicy& policy) {
+    socket.set(zmq::sockopt::sndhwm, Hwm(policy));
+}
+
+void ApplyRecvPolicy(zmq::socket_t& socket, const ChannelPolicy& policy) {
+    socket.set(zmq::sockopt::rcvhwm, Hwm(policy));
+}
+
+size_t ChannelReader::Drain(zmq::socket_t& socket, const ChannelPolicy& policy, std::atomic<uint64_t>& dropped, StreamKey key) {
+    for (Kept& k : kept_) { k.parts.clear(); spare_.push_back(std::move(k.parts)); }
+    kept_.clear();
+    bool lossless = policy.policy == DELIVERY_LOSSLESS;
+    size_t limit = lossless ? kLosslessBurst : policy.Limit();
+    while (!lossless || kept_.size() < limit) {
+        std::vector<zmq::message_t> parts;
+        if (!spare_.empty()) { parts = std::move(spare_.back()); spare_.pop_back(); }
+        if (!zmq::recv_multipart(socket, std::back_inserter(parts), zmq::recv_flags::dontwait)) { spare_.push_back(std::move(parts)); break; }
+        uint64_t stream = key ? key(parts) : 0;
+        if (!lossless) {
+            // Past the limit, this stream's oldest kept message goes
+            size_t count = 0;
+            auto oldest = kept_.end();
+            for (auto it = kept_.begin(); it != kept_.end(); ++it) {
+                if (it->stream != stream) continue;
+                if (count++ == 0) oldest = it;
+            }
+            if (count >= limit) {
+                oldest->parts.clear();
+                spare_.push_back(std::move(oldest->parts));
+                kept_.erase(oldest);
+                dropped++;
+            }
+        }
+        kept_.push_back(Kept{ stream, std::move(parts) });
+    }
+    return kept_.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <zmq.hpp>
+
+// How a ZMQ channel sheds load when its consumer falls behind. ZMQ_CONFLATE
+// is not an option: it silently breaks multipart messages. Instead
+// ChannelReader drains whatever is waiting and keeps only what the policy
+// allows, counting the rest. The socket HWMs leave room for that per stream:
+// a pipe at its HWM drops the newest messages, uncounted.
+enum DeliveryPolicy {
+    DELIVERY_CONFLATE = 0, // newest message only
+    DELIVERY_DROP_OLDEST,  // newest `depth` messages
+    DELIVERY_LOSSLESS,     // everything, no HWM
+    DELIVERY_POLICY_COUNT
+};
+
+enum Channel {
+    CHANNEL_FRAMES = 0, // bridge -> engine
+    CHANNEL_PREVIEW,    // engine -> bridge
+    CHANNEL_POSE,       // engine -> bridge
+    CHANNEL_EXTERNAL,   // external ZMQ frame source -> bridge
+    CHANNEL_COUNT
+};
+
+// Streams a channel multiplexes at most: every source plus the frames channel's sync messages
+constexpr int kMaxChannelStreams = 16;
+
+extern const char* kDeliveryPolicyNames[DELIVERY_POLICY_COUNT];
+extern const char* kChannelNames[CHANNEL_COUNT];
+
+struct ChannelPolicy {
+    std::atomic<DeliveryPolicy> policy;
+    std::atomic<int> depth;
+
+    ChannelPolicy(DeliveryPolicy p, int d) : policy(p), depth(d) {}
+    // Messages kept per drain for the bounded policies
+    size_t Limit() const {
+        int d = depth;
+        return policy == DELIVERY_CONFLATE ? 1 : size_t(d > 0 ? d : 1);
+    }
+};
+
+// SNDHWM / RCVHWM sized for the policy's per-stream limit on every stream. Call before bind / connect: HWMs only
+// apply to connections made afterwards.
+void ApplySendPolicy(zmq::socket_t& socket, const ChannelPolicy& policy);
+void ApplyRecvPolicy(zmq::socket_t& socket, const ChannelPolicy& policy);
+
+// Which stream (source) a message belongs to; the limits apply per stream,
+// as engine.py applies them per topic
+using StreamKey = uint64_t (*)(const std::vector<zmq::message_t>& parts);
+
+class ChannelReader {
+public:
+    static constexpr size_t kLosslessBurst = 64; // lossless drains stop here and leave the rest queued
+
+    // Receives the complete messages waiting on `socket` without blocking and
+    // keeps them per `policy` and stream; discarded ones are added to `dropped`.
+    // Without `key` the channel is one stream. Returns the number kept.
+    size_t Drain(zmq::socket_t& socket, const ChannelPolicy& policy, std::atomic<uint64_t>& dropped, StreamKey key = nullptr);
+    size_t Size() const { return kept_.size(); }
+    // Kept messages oldest first, valid until the next Drain
+    std::vector<zmq::message_t>& At(size_t i) { return kept_[i].parts; }
+
+private:
+    struct Kept {
+        uint64_t stream;
+        std::vector<zmq::message_t> parts;
+    };
+
+    std::deque<Kept> kept_;
+    std::vector<std::vector<zmq::message_t>> spare_; // part vectors reused between drains
+};
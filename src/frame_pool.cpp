@@ -0,0 +1,57 @@
+#include "frame_pool.h"
+
+#include <algorithm>
+
+// Only this pool's own header left: nobody else holds the slab
+static bool Unshared(const cv::Mat& slab) {
+    return slab.u && CV_XADD(&slab.u->refcount, 0) == 1;
+}
+
+cv::Mat FramePool::Acquire(int rows, int cols, int type) {
+    auto it = std::find_if(shapes_.begin(), shapes_.end(), [&](const Shape& s) { return s.rows == rows && s.cols == cols && s.type == type; });
+    if (it == shapes_.end()) {
+        // Slabs still in flight stay alive through their holders' references
+        if (shapes_.size() >= kMaxShapes) shapes_.erase(shapes_.begin());
+        shapes_.push_back(Shape{ rows, cols, type, {} });
+        it = shapes_.end() - 1;
+    }
+    for (const cv::Mat& slab : it->slabs) if (Unshared(slab)) return slab;
+    if (it->slabs.size() < kMaxSlabs) { it->slabs.emplace_back(rows, cols, type); return it->slabs.back(); }
+    misses_++;
+    return cv::Mat(rows, cols, type);
+}
+
+cv::Mat FramePool::AcquireBytes(size_t size) {
+    int capacity = 64 * 1024;
+    while ((size_t)capacity < size) capacity *= 2;
+    cv::Mat slab = Acquire(1, capacity, CV_8UC1);
+    return slab(cv::Rect(0, 0, (int)size, 1));
+}
+
+BufferPool::~BufferPool() {
+    for (Buffer* b : free_) delete b;
+}
+
+BufferPool::Handle BufferPool::Acquire() {
+    Buffer* b = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) { b = free_.back(); free_.pop_back(); }
+    }
+    if (!b) { b = new Buffer(); b->pool = this; }
+    b->bytes.clear();
+    return Handle(b);
+}
+
+void BufferPool::Put(Buffer* b) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < kMaxFree) { free_.push_back(b); return; }
+    }
+    delete b;
+}
+
+void BufferPool::FreeMessage(void*, void* hint) {
+    Buffer* b = static_cast<Buffer*>(hint);
+    b->pool->Put(b);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Reused storage for the per-frame allocations of the capture -> publish path.
+
+// Image slabs keyed by shape. A slab is handed out again once every Mat that
+// shares it (UI triple buffer, encoder queue, engine batch) is gone, which
+// OpenCV's refcount tells us, so nothing has to be returned explicitly.
+// Acquire from one thread only; the Mats themselves may be released anywhere.
+class FramePool {
+public:
+    static constexpr size_t kMaxSlabs = 12; // per shape, more than a frame's possible holders
+    static constexpr size_t kMaxShapes = 6; // the least recently added shape is forgotten past this
+
+    cv::Mat Acquire(int rows, int cols, int type);
+    // 1 x `size` CV_8UC1 view for a compressed frame; slabs are powers of two from 64 KB
+    cv::Mat AcquireBytes(size_t size);
+    // Frames that had to be allocated because every slab of their shape was in use
+    uint64_t Misses() const { return misses_; }
+
+private:
+    struct Shape {
+        int rows, cols, type;
+        std::vector<cv::Mat> slabs;
+    };
+
+    std::vector<Shape> shapes_;
+    uint64_t misses_ = 0;
+};
+
+// Byte buffers that keep their capacity between uses, for frame metadata and
+// payloads. They go out as zero-copy ZMQ messages and come back through the
+// message's free callback, from whichever thread ZMQ releases them on.
+class BufferPool {
+public:
+    struct Buffer {
+        std::vector<uint8_t> bytes;
+        BufferPool* pool = nullptr;
+    };
+    struct Releaser { void operator()(Buffer* b) const { b->pool->Put(b); } };
+    using Handle = std::unique_ptr<Buffer, Releaser>;
+
+    static constexpr size_t kMaxFree = 32;
+
+    BufferPool() { free_.reserve(kMaxFree); }
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // An empty buffer, with the capacity it last grew to
+    Handle Acquire();
+    // zmq_free_fn for a message built on a released Handle; `hint` is the Buffer
+    static void FreeMessage(void* data, void* hint);
+
+private:
+    void Put(Buffer* b);
+
+    std::mutex mutex_;
+    std::vector<Buffer*> free_;
+};
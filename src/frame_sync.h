@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Groups frames from several cameras whose capture times fall within a
+// tolerance, so the engine can run one multi-view batch per group. Keeps only
+// the newest pending frame per source; a frame that can no longer be matched
+// (older than the newest pending one minus the tolerance) is dropped.
+// Single-threaded: owned by the publish stage.
+class FrameSync {
+public:
+    struct Entry {
+        int source_id = 0;
+        uint64_t frame_id = 0;
+        int64_t capture_us = 0;
+    };
+
+    // Replaces the source set and forgets any pending frames.
+    void SetSources(const std::vector<int>& source_ids) {
+        sources_ = source_ids;
+        pending_.assign(sources_.size(), Entry{});
+        has_.assign(sources_.size(), false);
+    }
+
+    size_t SourceCount() const { return sources_.size(); }
+
+    // Feeds a frame. Returns true and fills `group` (one entry per source, in
+    // SetSources order) when every source has a frame within `tolerance_us`.
+    bool Add(const Entry& e, int64_t tolerance_us, std::vector<Entry>& group) {
+        size_t idx = 0;
+        while (idx < sources_.size() && sources_[idx] != e.source_id) idx++;
+        if (idx == sources_.size()) return false;
+        pending_[idx] = e; has_[idx] = true;
+        int64_t newest = e.capture_us;
+        for (size_t i = 0; i < sources_.size(); i++) if (has_[i] && pending_[i].capture_us > newest) newest = pending_[i].capture_us;
+        bool complete = true;
+        for (size_t i = 0; i < sources_.size(); i++) {
+            if (has_[i] && newest - pending_[i].capture_us > tolerance_us) has_[i] = false;
+            complete = complete && has_[i];
+        }
+        if (!complete) return false;
+        group = pending_;
+        has_.assign(sources_.size(), false);
+        return true;
+    }
+
+private:
+    std::vector<int> sources_;
+    std::vector<Entry> pending_;
+    std::vector<bool> has_;
+};
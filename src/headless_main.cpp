@@ -0,0 +1,167 @@
+// PoseBridgeHeadless: the capture/engine pipeline without a window or GL
+// context, configured from a file and/or flags and controlled over ZMQ REQ/REP.
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <zmq.hpp>
+
+#include "app_state.h"
+#include "backend.h"
+#include "camera_enum.h"
+#include "config.h"
+#include "pipeline.h"
+#include "zmq_context.h"
+
+struct HeadlessOptions {
+    std::string status_endpoint = "tcp://*:6010"; // empty disables the status server
+    std::string python_exe;                       // empty: venv python, else system python
+    bool launch_engine = false;
+    bool start_stream = true;
+};
+
+static HeadlessOptions opts;
+static std::atomic<bool> g_stop{ false };
+
+static void OnSignal(int) { g_stop = true; }
+
+static void PrintUsage() {
+    std::puts(
+        "Usage: PoseBridgeHeadless [--config file] [--key value]...\n"
+        "  --source cam|zmq|replay capture source (default cam)\n"
+        "  --cam N[,N...]          local camera indices, captured concurrently\n"
+        "  --resolution WxH        capture size of every camera (default 640x480)\n"
+        "  --fps N                 capture rate (0 = driver default)\n"
+        "  --fourcc CODE           pixel format, e.g. MJPG or YUYV (default = driver default)\n"
+        "  --camN_resolution / --camN_fps / --camN_fourcc   the same for camera N only\n"
+        "  --mjpeg_passthrough on|off  forward MJPG cameras' JPEGs to engine.py without re-encoding (default on)\n"
+        "  --sync_tolerance_ms N   max capture-time spread of a multi-camera group (default 8)\n"
+        "  --roi on|off            ship only a crop around the last pose's person (default off)\n"
+        "  --roi_padding X         crop margin, relative to the person box's larger side (default 0.25)\n"
+        "  --roi_keyframe_interval N  full frame every N frames for re-detection (default 30, 0 = never)\n"
+        "  --roi_min_size N        smallest crop side in pixels (default 128)\n"
+        "  --zmq_addr ADDR         external ZMQ frame source\n"
+        "  --replay FILE           recording played back by --source replay\n"
+        "  --replay_speed X        1 = recorded timing, 0 = as fast as possible (default 1)\n"
+        "  --replay_loop on|off    start over at the end (default on)\n"
+        "  --record FILE|off       record published frames and received poses to FILE\n"
+        "  --transport jpeg|shm    frame transport to the engine\n"
+        "  --shm_slots N           shared-memory ring slots\n"
+        "  --jpeg_codec NAME       opencv | turbojpeg | nvjpeg (default turbojpeg if built in)\n"
+        "  --CH_policy P           CH = frames|preview|pose|external, P = conflate|drop_oldest|lossless\n"
+        "  --CH_depth N            queue depth for drop_oldest\n"
+        "  --script PATH           engine script (default scripts/engine.py)\n"
+        "  --engine_backend K      python (engine.py) | native (in-process)\n"
+        "  --model PATH            native: .onnx model, or a TensorRT .engine for --provider tensorrt\n"
+        "  --model_format F        native: simcc (RTMPose) | blazepose\n"
+        "  --provider P            native: cpu | cuda | directml | tensorrt\n"
+        "  --preprocess D          native: letterbox + normalize on cpu | opencl | cuda (default cpu)\n"
+        "  --min_score X           native: mean keypoint score needed to report a person (default 0.3)\n"
+        "  --engine_threads N      native: ONNX Runtime intra-op threads (0 = default)\n"
+        "  --batch_max N           native: max frames per forward pass across sources (default 4)\n"
+        "  --batch_delay_us N      native: max wait for a batch to fill (default 2000)\n"
+        "  --stale_ms N            native: drop frames older than this at dispatch (default 100, 0 = never)\n"
+        "  --output_S on|off       S = openvr|ros2|vmc|udp|compact: forward poses to that sink\n"
+        "  --output_S_target T     openvr: shm name, ros2: topic, vmc/udp/compact: host:port\n"
+        "  --compact_keyframe_interval N  compact: a keyframe every N poses per source (default 30)\n"
+        "  --compact_deadband N    compact: resend a keypoint once it moved more than N steps (default 2)\n"
+        "  --pose_filter on|off    One-Euro smoothing + prediction of the poses sent to outputs\n"
+        "  --filter_min_cutoff HZ  --filter_beta X  --filter_d_cutoff HZ   One-Euro parameters (1.0, 0.5, 1.0)\n"
+        "  --predict_lead_ms N     outputs predict to send time + N ms (default 0)\n"
+        "  --predict_max_ms N      max extrapolation past the newest pose (default 100)\n"
+        "  --python PATH           python interpreter for the engine\n"
+        "  --frames_endpoint E     frame PUB bind (default tcp://*:6000); also preview_/pose_/control_endpoint\n"
+        "  --engine_ipc on|off     reach the spawned engine.py over ipc:// instead of TCP (default on)\n"
+        "  --zmq_io_threads N      IO threads of the shared ZMQ context (default 1)\n"
+        "  --zmq_io_cpus L         pin them to these CPUs, e.g. 2,3 (default none)\n"
+        "  --R_cpus L              pin thread role R to CPUs L, e.g. 2,3 (default any);\n"
+        "                          R = capture|encode|publish|receiver|inference|output|engine\n"
+        "  --R_priority P          P = normal|high|realtime (realtime = SCHED_FIFO / MMCSS)\n"
+        "  --engine_standby on|off keep a warm engine.py standby for failover (default on)\n"
+        "  --engine_heartbeat_ms N fail over when engine.py misses heartbeats this long (default 500)\n"
+        "  --engine on|off         launch the engine on start\n"
+        "  --stream on|off         start capturing on start (default on)\n"
+        "  --status ENDPOINT       REP status endpoint (default tcp://*:6010, empty to disable)\n"
+        "Status commands: status | start | stop | engine start | engine stop | set KEY VALUE | quit");
+}
+
+static bool ApplyHeadlessOption(const std::string& key, const std::string& value) {
+    if (key == "status") opts.status_endpoint = value;
+    else if (key == "python") opts.python_exe = value;
+    else if (key == "engine") return ParseBool(value, opts.launch_engine);
+    else if (key == "stream") return ParseBool(value, opts.start_stream);
+    else return false;
+    return true;
+}
+
+static void LaunchEngine() {
+    StartEngine(opts.python_exe.empty() ? GetPythonPath() : opts.python_exe);
+}
+
+static std::string HandleCommand(const std::string& cmd) {
+    const std::string ok = "{\"ok\":true}";
+    if (cmd.empty() || cmd == "status") return StatusJson();
+    if (cmd == "start") { app.camera_active = true; return ok; }
+    if (cmd == "stop") { app.camera_active = false; return ok; }
+    if (cmd == "engine start") { LaunchEngine(); return ok; }
+    if (cmd == "engine stop") { StopBackend(); return ok; }
+    if (cmd == "quit") { g_stop = true; return ok; }
+    if (cmd.rfind("set ", 0) == 0) {
+        size_t sp = cmd.find(' ', 4);
+        if (sp != std::string::npos && ApplySetting(cmd.substr(4, sp - 4), cmd.substr(sp + 1))) return ok;
+        return "{\"ok\":false,\"error\":\"bad setting\"}";
+    }
+    return "{\"ok\":false,\"error\":\"unknown command\"}";
+}
+
+static void StatusServerThread(std::string endpoint) {
+    zmq::socket_t rep(SharedZmqContext(), zmq::socket_type::rep);
+    try { rep.bind(endpoint); }
+    catch (const zmq::error_t& e) { app.Log("[ERR] Status endpoint " + endpoint + ": " + e.what()); return; }
+    app.Log("[SYS] Status server on " + endpoint);
+    zmq::pollitem_t item = { rep, 0, ZMQ_POLLIN, 0 };
+    while (app.is_running) {
+        zmq::poll(&item, 1, std::chrono::milliseconds(200));
+        if (!(item.revents & ZMQ_POLLIN)) continue;
+        zmq::message_t req;
+        if (!rep.recv(req, zmq::recv_flags::none)) continue;
+        std::string reply = HandleCommand(req.to_string());
+        rep.send(zmq::buffer(reply), zmq::send_flags::none);
+    }
+}
+
+int main(int argc, char** argv) {
+    app.echo_stdout = true;
+    ConfigEntries entries;
+    if (!ParseCommandLine(argc, argv, entries)) { PrintUsage(); return 1; }
+    for (const auto& [key, value] : entries) {
+        if (key == "help") { PrintUsage(); return 0; }
+        if (!ApplyHeadlessOption(key, value) && !ApplySetting(key, value)) { app.Log("[ERR] Bad setting: " + key + " = " + value); return 1; }
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    if (app.source_mode == SOURCE_LOCAL_CAM) RefreshCameraList();
+    std::thread t1(CameraThread), t2(ReceiverThread), t3(PoseOutputThread), t4;
+    if (!opts.status_endpoint.empty()) t4 = std::thread(StatusServerThread, opts.status_endpoint);
+    if (opts.launch_engine) LaunchEngine();
+    app.camera_active = opts.start_stream;
+
+    while (!g_stop) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    app.Log("[SYS] Shutting down.");
+    StopBackend();
+    app.is_running = false;
+    JoinEngine();
+    if (t1.joinable()) t1.join();
+    if (t2.joinable()) t2.join();
+    if (t3.joinable()) t3.join();
+    if (t4.joinable()) t4.join();
+    WaitCameraScan();
+    app.recorder.Close();
+    return 0;
+}
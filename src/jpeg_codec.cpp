@@ -0,0 +1,229 @@
+#include "jpeg_codec.h"
+
+#include <cstdint>
+#include <string>
+
+#include <opencv2/imgcodecs.hpp>
+
+#ifdef POSEBRIDGE_HAS_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+#ifdef POSEBRIDGE_HAS_NVJPEG
+#include <cuda_runtime_api.h>
+#include <nvjpeg.h>
+#endif
+
+#include "app_state.h"
+
+const char* kJpegBackendNames[JPEG_BACKEND_COUNT] = { "opencv", "turbojpeg", "nvjpeg" };
+
+// --- 1. OpenCV ---
+class OpenCvJpegCodec : public JpegCodec {
+public:
+    JpegBackend Backend() const override { return JPEG_OPENCV; }
+
+    bool Encode(const cv::Mat& image, int quality, std::vector<uchar>& out) override {
+        return cv::imencode(".jpg", image, out, { cv::IMWRITE_JPEG_QUALITY, quality });
+    }
+
+    bool Decode(const void* data, size_t size, cv::Mat& out) override {
+        cv::imdecode(cv::Mat(1, (int)size, CV_8UC1, const_cast<void*>(data)), cv::IMREAD_COLOR, &out);
+        return !out.empty();
+    }
+};
+
+// --- 2. TurboJPEG ---
+#ifdef POSEBRIDGE_HAS_TURBOJPEG
+class TurboJpegCodec : public JpegCodec {
+public:
+    ~TurboJpegCodec() override {
+        if (buf_) tjFree(buf_);
+        if (enc_) tjDestroy(enc_);
+        if (dec_) tjDestroy(dec_);
+    }
+
+    bool Init() {
+        enc_ = tjInitCompress();
+        dec_ = tjInitDecompress();
+        return enc_ && dec_;
+    }
+
+    JpegBackend Backend() const override { return JPEG_TURBO; }
+
+    bool Encode(const cv::Mat& image, int quality, std::vector<uchar>& out) override {
+        if (image.type() != CV_8UC3) return false;
+        // Worst-case sized once per resolution; NOREALLOC keeps libjpeg-turbo from growing it per call
+        unsigned long need = tjBufSize(image.cols, image.rows, TJSAMP_420);
+        if (need > buf_size_) {
+            if (buf_) tjFree(buf_);
+            buf_ = tjAlloc((int)need);
+            buf_size_ = buf_ ? need : 0;
+        }
+        if (!buf_) return false;
+        unsigned long size = buf_size_;
+        if (tjCompress2(enc_, image.data, image.cols, (int)image.step, image.rows, TJPF_BGR, &buf_, &size,
+                        TJSAMP_420, quality, TJFLAG_FASTDCT | TJFLAG_NOREALLOC) != 0) return false;
+        out.assign(buf_, buf_ + size);
+        return true;
+    }
+
+    bool Decode(const void* data, size_t size, cv::Mat& out) override {
+        const unsigned char* src = static_cast<const unsigned char*>(data);
+        int w, h, subsamp, colorspace;
+        if (tjDecompressHeader3(dec_, src, (unsigned long)size, &w, &h, &subsamp, &colorspace) != 0) return false;
+        out.create(h, w, CV_8UC3);
+        return tjDecompress2(dec_, src, (unsigned long)size, out.data, w, (int)out.step, h, TJPF_BGR, TJFLAG_FASTDCT) == 0;
+    }
+
+private:
+    tjhandle enc_ = nullptr;
+    tjhandle dec_ = nullptr;
+    unsigned char* buf_ = nullptr;
+    unsigned long buf_size_ = 0;
+};
+#endif
+
+// --- 3. nvJPEG ---
+#ifdef POSEBRIDGE_HAS_NVJPEG
+class NvJpegCodec : public JpegCodec {
+public:
+    ~NvJpegCodec() override {
+        if (params_) nvjpegEncoderParamsDestroy(params_);
+        if (enc_state_) nvjpegEncoderStateDestroy(enc_state_);
+        if (dec_state_) nvjpegJpegStateDestroy(dec_state_);
+        if (handle_) nvjpegDestroy(handle_);
+        if (dev_buf_) cudaFree(dev_buf_);
+        if (stream_) cudaStreamDestroy(stream_);
+    }
+
+    bool Init() {
+        if (cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking) != cudaSuccess) return false;
+        if (nvjpegCreateSimple(&handle_) != NVJPEG_STATUS_SUCCESS) return false;
+        if (nvjpegEncoderStateCreate(handle_, &enc_state_, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        if (nvjpegEncoderParamsCreate(handle_, &params_, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        if (nvjpegEncoderParamsSetSamplingFactors(params_, NVJPEG_CSS_420, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        return nvjpegJpegStateCreate(handle_, &dec_state_) == NVJPEG_STATUS_SUCCESS;
+    }
+
+    JpegBackend Backend() const override { return JPEG_NVJPEG; }
+
+    bool Encode(const cv::Mat& image, int quality, std::vector<uchar>& out) override {
+        if (image.type() != CV_8UC3) return false;
+        if (quality != quality_) {
+            if (nvjpegEncoderParamsSetQuality(params_, quality, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+            quality_ = quality;
+        }
+        size_t pitch = size_t(image.cols) * 3;
+        if (!Reserve(pitch * image.rows)) return false;
+        cudaMemcpy2DAsync(dev_buf_, pitch, image.data, image.step, pitch, image.rows, cudaMemcpyHostToDevice, stream_);
+        nvjpegImage_t src{};
+        src.channel[0] = static_cast<unsigned char*>(dev_buf_);
+        src.pitch[0] = pitch;
+        if (nvjpegEncodeImage(handle_, enc_state_, params_, &src, NVJPEG_INPUT_BGRI, image.cols, image.rows, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        size_t size = 0;
+        if (nvjpegEncodeRetrieveBitstream(handle_, enc_state_, nullptr, &size, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        out.resize(size);
+        if (nvjpegEncodeRetrieveBitstream(handle_, enc_state_, out.data(), &size, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        cudaStreamSynchronize(stream_);
+        out.resize(size);
+        return true;
+    }
+
+    bool Decode(const void* data, size_t size, cv::Mat& out) override {
+        const unsigned char* src = static_cast<const unsigned char*>(data);
+        int components, widths[NVJPEG_MAX_COMPONENT], heights[NVJPEG_MAX_COMPONENT];
+        nvjpegChromaSubsampling_t subsampling;
+        if (nvjpegGetImageInfo(handle_, src, size, &components, &subsampling, widths, heights) != NVJPEG_STATUS_SUCCESS) return false;
+        int w = widths[0], h = heights[0];
+        size_t pitch = size_t(w) * 3;
+        if (!Reserve(pitch * h)) return false;
+        nvjpegImage_t dst{};
+        dst.channel[0] = static_cast<unsigned char*>(dev_buf_);
+        dst.pitch[0] = pitch;
+        if (nvjpegDecode(handle_, dec_state_, src, size, NVJPEG_OUTPUT_BGRI, &dst, stream_) != NVJPEG_STATUS_SUCCESS) return false;
+        out.create(h, w, CV_8UC3);
+        cudaMemcpy2DAsync(out.data, out.step, dev_buf_, pitch, pitch, h, cudaMemcpyDeviceToHost, stream_);
+        return cudaStreamSynchronize(stream_) == cudaSuccess;
+    }
+
+private:
+    // One device buffer shared by encode and decode, grown only
+    bool Reserve(size_t bytes) {
+        if (bytes <= dev_size_) return true;
+        if (dev_buf_) cudaFree(dev_buf_);
+        dev_size_ = 0;
+        if (cudaMalloc(&dev_buf_, bytes) != cudaSuccess) { dev_buf_ = nullptr; return false; }
+        dev_size_ = bytes;
+        return true;
+    }
+
+    cudaStream_t stream_ = nullptr;
+    nvjpegHandle_t handle_ = nullptr;
+    nvjpegEncoderState_t enc_state_ = nullptr;
+    nvjpegEncoderParams_t params_ = nullptr;
+    nvjpegJpegState_t dec_state_ = nullptr;
+    void* dev_buf_ = nullptr;
+    size_t dev_size_ = 0;
+    int quality_ = -1;
+};
+#endif
+
+bool JpegBackendAvailable(JpegBackend backend) {
+    switch (backend) {
+    case JPEG_OPENCV: return true;
+#ifdef POSEBRIDGE_HAS_TURBOJPEG
+    case JPEG_TURBO: return true;
+#endif
+#ifdef POSEBRIDGE_HAS_NVJPEG
+    case JPEG_NVJPEG: return true;
+#endif
+    default: return false;
+    }
+}
+
+JpegBackend DefaultJpegBackend() {
+    return JpegBackendAvailable(JPEG_TURBO) ? JPEG_TURBO : JPEG_OPENCV;
+}
+
+std::unique_ptr<JpegCodec> CreateJpegCodec(JpegBackend backend) {
+    if (backend == JPEG_OPENCV) return std::make_unique<OpenCvJpegCodec>();
+    bool compiled = JpegBackendAvailable(backend);
+#ifdef POSEBRIDGE_HAS_TURBOJPEG
+    if (backend == JPEG_TURBO) {
+        auto codec = std::make_unique<TurboJpegCodec>();
+        if (codec->Init()) return codec;
+    }
+#endif
+#ifdef POSEBRIDGE_HAS_NVJPEG
+    if (backend == JPEG_NVJPEG) {
+        auto codec = std::make_unique<NvJpegCodec>();
+        if (codec->Init()) return codec;
+    }
+#endif
+    std::string name = backend < JPEG_BACKEND_COUNT ? kJpegBackendNames[backend] : "?";
+    app.Log("[ERR] JPEG codec " + name + (compiled ? " failed to initialize" : " not built in") + ", using OpenCV.");
+    return std::make_unique<OpenCvJpegCodec>();
+}
+
+bool JpegImageSize(const void* data, size_t size, int& width, int& height) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    if (size < 4 || p[0] != 0xFF || p[1] != 0xD8) return false;
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (p[pos] != 0xFF) return false;
+        uint8_t marker = p[pos + 1];
+        if (marker == 0xFF) { pos++; continue; } // fill byte
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { pos += 2; continue; } // no length field
+        if (marker == 0xD9 || marker == 0xDA) return false; // EOI / SOS before any frame header
+        size_t len = (size_t(p[pos + 2]) << 8) | p[pos + 3];
+        // SOF0..SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (len < 7 || pos + 9 > size) return false;
+            height = (p[pos + 5] << 8) | p[pos + 6];
+            width = (p[pos + 7] << 8) | p[pos + 8];
+            return width > 0 && height > 0;
+        }
+        pos += 2 + len;
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Pluggable JPEG encode/decode. Codecs hold library handles and scratch
+// buffers, so each thread owns its own instance (see JpegCodecSlot).
+enum JpegBackend {
+    JPEG_OPENCV = 0, // cv::imencode / cv::imdecode, always available
+    JPEG_TURBO,      // libjpeg-turbo via a persistent TurboJPEG handle
+    JPEG_NVJPEG,     // NVIDIA nvJPEG on the default CUDA device
+    JPEG_BACKEND_COUNT
+};
+
+extern const char* kJpegBackendNames[JPEG_BACKEND_COUNT]; // config / UI names
+
+class JpegCodec {
+public:
+    virtual ~JpegCodec() = default;
+    virtual JpegBackend Backend() const = 0;
+    // Encodes a BGR8 image into `out`, replacing its contents.
+    virtual bool Encode(const cv::Mat& image, int quality, std::vector<uchar>& out) = 0;
+    // Decodes to BGR8, reusing `out`'s storage when the size is unchanged.
+    virtual bool Decode(const void* data, size_t size, cv::Mat& out) = 0;
+};
+
+// Whether the backend was compiled in. Runtime initialization can still fail.
+bool JpegBackendAvailable(JpegBackend backend);
+// TurboJPEG when compiled in, else OpenCV
+JpegBackend DefaultJpegBackend();
+// Falls back to the OpenCV codec (and logs why) if `backend` can't be created.
+std::unique_ptr<JpegCodec> CreateJpegCodec(JpegBackend backend);
+
+// Image size from a JPEG's frame header, without decoding it
+bool JpegImageSize(const void* data, size_t size, int& width, int& height);
+
+// A thread's codec, recreated when the selected backend changes
+struct JpegCodecSlot {
+    std::unique_ptr<JpegCodec> codec;
+    JpegBackend selected = JPEG_BACKEND_COUNT;
+
+    JpegCodec& Get(JpegBackend backend) {
+        if (!codec || backend != selected) { codec = CreateJpegCodec(backend); selected = backend; }
+        return *codec;
+    }
+};
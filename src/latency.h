@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// HDR-style log-linear histogram of microsecond values. Each power of two is
+// split into 16 linear sub-buckets (~6% relative precision) from 1 us up to
+// ~9 hours in 512 counters. Record() is one relaxed atomic add, so any number
+// of threads can record while the UI reads.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSub = 1 << kSubBits;
+    static constexpr int kMajors = 32;
+    static constexpr int kBuckets = kMajors * kSub;
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t total = 0;
+
+        // Value (us) at quantile q in [0, 1]; 0 if empty.
+        int64_t Percentile(double q) const {
+            if (total == 0) return 0;
+            uint64_t target = (uint64_t)(q * total + 0.5);
+            if (target < 1) target = 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < kBuckets; i++) {
+                seen += counts[i];
+                if (seen >= target) return BucketMid(i);
+            }
+            return BucketMid(kBuckets - 1);
+        }
+
+        // Counts recorded since `older` was taken.
+        Snapshot Since(const Snapshot& older) const {
+            Snapshot d;
+            for (int i = 0; i < kBuckets; i++) d.counts[i] = counts[i] - older.counts[i];
+            d.total = total - older.total;
+            return d;
+        }
+    };
+
+    void Record(int64_t us) {
+        counts_[BucketOf(us < 0 ? 0 : (uint64_t)us)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Read(Snapshot& out) const {
+        out.total = 0;
+        for (int i = 0; i < kBuckets; i++) { out.counts[i] = counts_[i].load(std::memory_order_relaxed); out.total += out.counts[i]; }
+    }
+
+    static int BucketOf(uint64_t v) {
+        if (v < (uint64_t)kSub) return (int)v;
+        int msb = 63;
+        while (!(v >> msb)) msb--;
+        int major = msb - kSubBits + 1;
+        if (major >= kMajors) return kBuckets - 1;
+        int sub = (int)(v >> (msb - kSubBits)) & (kSub - 1);
+        return major * kSub + sub;
+    }
+
+    static int64_t BucketMid(int idx) {
+        int major = idx / kSub, sub = idx % kSub;
+        if (major == 0) return sub;
+        int64_t width = int64_t(1) << (major - 1);
+        return ((int64_t(kSub) + sub) << (major - 1)) + width / 2;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+};
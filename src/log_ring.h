@@ -0,0 +1,83 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+
+enum LogLevel : uint8_t { LOG_INFO = 0, LOG_WARN = 1, LOG_ERROR = 2 };
+enum LogSource : uint8_t { LOG_APP = 0, LOG_ENGINE = 1 }; // LOG_ENGINE: engine.py output, shown with a [PY] prefix
+
+struct LogRecord {
+    int64_t time = 0;     // time_t, formatted only when the line is shown
+    LogLevel level = LOG_INFO;
+    LogSource source = LOG_APP;
+    uint16_t length = 0;
+    char text[236];       // truncated, not NUL-terminated; sized so a slot is 256 bytes
+};
+
+// Fixed-capacity log history written by any number of threads without locks
+// or allocation. Each writer claims a sequence number and copies its line into
+// that slot under a per-slot seqlock; the oldest lines are overwritten. Readers
+// address lines by sequence number and skip those torn by a concurrent write.
+class LogRing {
+public:
+    static constexpr uint64_t kCapacity = 2048; // power of two
+
+    // Returns the line's sequence number
+    uint64_t Push(std::string_view msg, LogLevel level, LogSource source) {
+        uint64_t n = head_.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = slots_[n & (kCapacity - 1)];
+        s.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.record.time = (int64_t)std::time(nullptr);
+        s.record.level = level;
+        s.record.source = source;
+        s.record.length = (uint16_t)std::min(msg.size(), sizeof(s.record.text));
+        std::memcpy(s.record.text, msg.data(), s.record.length);
+        s.seq.store(2 * n + 2, std::memory_order_release);
+        return n;
+    }
+
+    // Sequence number the next line will get; lines [End() - kCapacity, End()) may still be readable
+    uint64_t End() const { return head_.load(std::memory_order_acquire); }
+    uint64_t Begin() const { uint64_t end = End(); return end > kCapacity ? end - kCapacity : 0; }
+
+    // False if line `n` was overwritten or is still being written
+    bool Read(uint64_t n, LogRecord& out) const {
+        const Slot& s = slots_[n & (kCapacity - 1)];
+        if (s.seq.load(std::memory_order_acquire) != 2 * n + 2) return false;
+        out = s.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.seq.load(std::memory_order_relaxed) == 2 * n + 2;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> seq{ 0 }; // 2n+1 while line n is written, 2n+2 once complete
+        LogRecord record;
+    };
+
+    alignas(64) std::atomic<uint64_t> head_{ 0 };
+    Slot slots_[kCapacity];
+};
+
+// Severity from the conventions already used in messages: "[ERR]" / "Error" / "Traceback", "[WARN]" / "Warning"
+inline LogLevel ClassifyLog(std::string_view msg) {
+    if (msg.find("[ERR]") != std::string_view::npos || msg.find("Error") != std::string_view::npos || msg.find("Traceback") != std::string_view::npos) return LOG_ERROR;
+    if (msg.find("[WARN]") != std::string_view::npos || msg.find("Warning") != std::string_view::npos) return LOG_WARN;
+    return LOG_INFO;
+}
+
+// "HH:MM:SS" local time of a record; reentrant, unlike localtime()
+inline void FormatLogTime(int64_t time, char (&out)[9]) {
+    time_t t = (time_t)time;
+    tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    std::strftime(out, sizeof(out), "%H:%M:%S", &local);
+}
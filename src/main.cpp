@@ -1,144 +1,40 @@
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <vector>
 #include <string>
-#include <mutex>
-#include <deque>
-#include <cstdio>
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
-#include <array>
-#include <sstream>
-
-// ZMQ
-#include <zmq.hpp>
-#include <zmq_addon.hpp>
-
-// OpenCV
-#include <opencv2/opencv.hpp>
 
 // ImGui
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
-// --- Platform Specific Headers ---
-#ifdef _WIN32
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#else
-#include <unistd.h>
-#include <signal.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <spawn.h>
-#include <poll.h>
-pid_t g_backend_pid = -1;
-#endif
+#include "app_state.h"
+#include "backend.h"
+#include "camera_enum.h"
+#include "clock.h"
+#include "config.h"
+#include "pipeline.h"
+#include "skeleton.h"
+#include "texture_streamer.h"
+#include "zmq_context.h"
 
 namespace fs = std::filesystem;
 
-// --- 0. Enum & Consts ---
-enum DataSourceMode {
-    SOURCE_LOCAL_CAM = 0,
-    SOURCE_EXTERNAL_ZMQ = 1
-};
-
-// --- 1. Global Application State ---
-struct AppState {
-    // === Settings ===
-    DataSourceMode source_mode = SOURCE_LOCAL_CAM;
-    int selected_cam_index = 0;
-    std::vector<int> available_cams;
-    std::string external_zmq_addr = "tcp://127.0.0.1:5555";
-
-    // [] ǷʾԤͼ ( GPU ռ)
-    bool show_previews = true;
-
-    // ZMQ Ports
-    int port_pub_frames = 6000;
-    int port_sub_preview = 6001;
-    int port_sub_pose = 6002;
-
-    std::string python_script = "scripts/engine.py";
-
-    // === Runtime Status ===
-    std::atomic<bool> is_running{ true };
-    std::atomic<bool> camera_active{ false };
-    std::atomic<bool> backend_running{ false };
-
-    // [̿]
-    std::mutex proc_mutex;
-    void* backend_process_handle = nullptr; // Windows Handle
-
-    // Connection Status
-    std::atomic<bool> status_cam_pub{ false };
-    std::atomic<bool> status_prev_sub{ false };
-    std::atomic<bool> status_pose_sub{ false };
-
-    // === Installer State ===
-    std::atomic<bool> is_installing{ false };
-    std::atomic<float> install_progress{ 0.0f };
-    std::string install_status_text = "Idle";
-
-    // === Data Buffers ===
-    std::mutex data_mutex;
-    cv::Mat frame_raw;
-    cv::Mat frame_preview;
-    std::vector<float> pose_data;
-
-    // OpenGL Textures
-    GLuint tex_raw = 0;
-    GLuint tex_preview = 0;
-
-    // === Logger ===
-    std::mutex log_mutex;
-    std::deque<std::string> logs;
-    bool scroll_to_bottom = false;
+// GL-side state, owned by the render thread
+struct UiState {
+    TextureStreamer tex_raw;
+    TextureStreamer tex_preview;
+} ui;
 
-    void Log(const std::string& msg) {
-        std::lock_guard<std::mutex> lock(log_mutex);
-        time_t now = time(0);
-        tm* ltm = localtime(&now);
-        char time_buf[16];
-        sprintf(time_buf, "[%02d:%02d:%02d] ", ltm->tm_hour, ltm->tm_min, ltm->tm_sec);
-        logs.push_back(std::string(time_buf) + msg);
-        if (logs.size() > 2000) logs.pop_front();
-        scroll_to_bottom = true;
-    }
-} app;
-
-// --- 2. Helper Functions ---
-
-void StopBackend() {
-    std::lock_guard<std::mutex> lock(app.proc_mutex);
-#ifdef _WIN32
-    if (app.backend_process_handle != nullptr) {
-        HANDLE hProcess = (HANDLE)app.backend_process_handle;
-        DWORD exitCode = 0;
-        if (GetExitCodeProcess(hProcess, &exitCode) && exitCode == STILL_ACTIVE) {
-            if (TerminateProcess(hProcess, 1)) {
-                app.Log("[SYS] Kill signal sent (Windows).");
-            }
-            else {
-                app.Log("[ERR] TerminateProcess failed.");
-            }
-        }
-    }
-#else
-    if (g_backend_pid > 0) {
-        if (kill(g_backend_pid, SIGTERM) == 0) {
-            app.Log("[SYS] SIGTERM sent to PID " + std::to_string(g_backend_pid));
-            int status;
-            waitpid(g_backend_pid, &status, WNOHANG);
-        }
-        else {
-            app.Log("[ERR] Failed to kill PID " + std::to_string(g_backend_pid));
-        }
-    }
-#endif
-}
+// --- 1. Helper Functions ---
 
 void DrawStatusDot(bool active, float radius = 6.0f) {
     ImVec2 p = ImGui::GetCursorScreenPos();
@@ -150,251 +46,114 @@ void DrawStatusDot(bool active, float radius = 6.0f) {
     ImGui::Dummy(ImVec2(radius * 2 + 5, radius * 2));
 }
 
-void RefreshCameraList() {
-    app.Log("Scanning cameras...");
-    std::vector<int> found;
-    for (int i = 0; i < 4; i++) {
-        cv::VideoCapture temp_cap(i);
-        if (temp_cap.isOpened()) {
-            found.push_back(i);
-            temp_cap.release();
-        }
-    }
-    app.available_cams = found;
-    if (found.empty()) app.Log("No cameras found.");
-    else app.Log("Found " + std::to_string(found.size()) + " cameras.");
-}
-
-// ģϴ OpenCV Mat  OpenGL 
-//  app.show_previews Ϊ falseUIѭнô˺ӶʡԴ
-void UpdateTexture(GLuint& texID, const cv::Mat& mat) {
-    if (mat.empty()) return;
-    if (texID == 0) glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    cv::Mat rgb;
-    cv::cvtColor(mat, rgb, cv::COLOR_BGR2RGB);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, rgb.cols, rgb.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb.data);
+// 核心：上传 OpenCV Mat 到 OpenGL 纹理
+// 如果 app.show_previews 为 false，UI循环中将不调用此函数，从而节省显存带宽
+void UpdateTexture(TextureStreamer& tex, const FrameSlot& slot, LatencyStage stage) {
+    if (tex.Upload(slot.image, slot.seq) && slot.capture_us) app.latency[stage].Record(WallClockMicros() - slot.capture_us);
 }
 
-std::string GetPythonPath() {
-    fs::path cwd = fs::current_path();
-#ifdef _WIN32
-    fs::path venv_py = cwd / "venv" / "Scripts" / "python.exe";
-    if (fs::exists(venv_py)) return venv_py.string();
-    return "python";
-#else
-    fs::path venv_py = cwd / "venv" / "bin" / "python";
-    if (fs::exists(venv_py)) return venv_py.string();
-    return "python3";
-#endif
-}
-
-// --- 3. Process Logic ---
-
-bool ExecCommand(const std::string& cmd) {
-#ifdef _WIN32
-    SECURITY_ATTRIBUTES saAttr; saAttr.nLength = sizeof(SECURITY_ATTRIBUTES); saAttr.bInheritHandle = TRUE; saAttr.lpSecurityDescriptor = NULL;
-    HANDLE hChildOut_Rd, hChildOut_Wr;
-    if (!CreatePipe(&hChildOut_Rd, &hChildOut_Wr, &saAttr, 0)) return false;
-    SetHandleInformation(hChildOut_Rd, HANDLE_FLAG_INHERIT, 0);
-    STARTUPINFOA si; ZeroMemory(&si, sizeof(si)); si.cb = sizeof(si); si.hStdError = hChildOut_Wr; si.hStdOutput = hChildOut_Wr; si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW; si.wShowWindow = SW_HIDE;
-    PROCESS_INFORMATION pi; ZeroMemory(&pi, sizeof(pi));
-    std::string cmd_wrapped = "cmd.exe /c " + cmd;
-    std::vector<char> buf(cmd_wrapped.begin(), cmd_wrapped.end()); buf.push_back(0);
-    if (!CreateProcessA(NULL, buf.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) { CloseHandle(hChildOut_Rd); CloseHandle(hChildOut_Wr); return false; }
-    CloseHandle(hChildOut_Wr);
-    DWORD dwRead; CHAR chBuf[1024]; std::string line;
-    while (ReadFile(hChildOut_Rd, chBuf, sizeof(chBuf), &dwRead, NULL) && dwRead != 0) {
-        for (DWORD i = 0; i < dwRead; i++) { if (chBuf[i] == '\n' || chBuf[i] == '\r') { if (!line.empty()) { app.Log(line); line.clear(); } } else line += chBuf[i]; }
-    }
-    if (!line.empty()) app.Log(line);
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    DWORD exitCode = 0; GetExitCodeProcess(pi.hProcess, &exitCode);
-    CloseHandle(pi.hProcess); CloseHandle(pi.hThread); CloseHandle(hChildOut_Rd);
-    return exitCode == 0;
-#else
-    FILE* pipe = popen((cmd + " 2>&1").c_str(), "r");
-    if (!pipe) return false;
-    char buffer[256];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = buffer;
-        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
-        app.Log(line);
+// Skeleton of the shown source's latest pose over the image just drawn; used when the engine sends no preview
+void DrawPoseOverlay() {
+    TripleBuffer<PoseSlot>& poses = app.image_poses[app.PreviewSource()];
+    poses.Update();
+    const PoseSlot& pose = poses.ReadBuffer();
+    const PoseHeader& h = pose.header;
+    // A pose older than half a second belongs to a scene that has moved on
+    if (!pose.seq || h.layout != POSE_LAYOUT_IMAGE_XYZV || h.components < 4 || WallClockMicros() - pose.recv_us > 500000) return;
+    size_t stride = (size_t)h.keypoint_count * h.components;
+    if (pose.keypoints.size() < stride * h.person_count) return;
+    ImVec2 origin = ImGui::GetItemRectMin(), max = ImGui::GetItemRectMax();
+    ImVec2 size(max.x - origin.x, max.y - origin.y);
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    size_t edge_count;
+    const SkeletonEdge* edges = SkeletonEdges(h.keypoint_count, edge_count);
+    const float min_vis = 0.5f;
+    for (int person = 0; person < h.person_count; person++) {
+        const float* kp = pose.keypoints.data() + person * stride;
+        auto point = [&](int i) { return ImVec2(origin.x + kp[i * h.components] * size.x, origin.y + kp[i * h.components + 1] * size.y); };
+        auto visible = [&](int i) { return kp[i * h.components + 3] >= min_vis; };
+        for (size_t e = 0; e < edge_count; e++)
+            if (visible(edges[e].a) && visible(edges[e].b)) draw_list->AddLine(point(edges[e].a), point(edges[e].b), IM_COL32(255, 255, 255, 200), 2.0f);
+        for (int i = 0; i < h.keypoint_count; i++)
+            if (visible(i)) draw_list->AddCircleFilled(point(i), 3.0f, IM_COL32(50, 205, 50, 255));
     }
-    return pclose(pipe) == 0;
-#endif
 }
 
-void BackendMonitorThread(std::string python_exe, std::string script_path) {
-    if (app.backend_running) return;
-    app.backend_running = true;
-    app.Log("[SYS] Launching: " + python_exe);
-
-#ifdef _WIN32
-    SECURITY_ATTRIBUTES saAttr; saAttr.nLength = sizeof(SECURITY_ATTRIBUTES); saAttr.bInheritHandle = TRUE; saAttr.lpSecurityDescriptor = NULL;
-    HANDLE hChildOut_Rd, hChildOut_Wr;
-    CreatePipe(&hChildOut_Rd, &hChildOut_Wr, &saAttr, 0);
-    SetHandleInformation(hChildOut_Rd, HANDLE_FLAG_INHERIT, 0);
-    STARTUPINFOA si; ZeroMemory(&si, sizeof(si)); si.cb = sizeof(si); si.hStdError = hChildOut_Wr; si.hStdOutput = hChildOut_Wr; si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW; si.wShowWindow = SW_HIDE;
-    PROCESS_INFORMATION pi; ZeroMemory(&pi, sizeof(pi));
-    std::string cmd = "\"" + python_exe + "\" -u -X utf8 \"" + script_path + "\"";
-    std::vector<char> buf(cmd.begin(), cmd.end()); buf.push_back(0);
-
-    if (CreateProcessA(NULL, buf.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        CloseHandle(hChildOut_Wr); CloseHandle(pi.hThread);
-        { std::lock_guard<std::mutex> lock(app.proc_mutex); app.backend_process_handle = pi.hProcess; }
-        DWORD dwRead; CHAR chBuf[1024]; std::string line;
-        while (app.is_running && ReadFile(hChildOut_Rd, chBuf, sizeof(chBuf), &dwRead, NULL) && dwRead != 0) {
-            for (DWORD i = 0; i < dwRead; i++) { if (chBuf[i] == '\n' || chBuf[i] == '\r') { if (!line.empty()) { app.Log("[PY] " + line); line.clear(); } } else line += chBuf[i]; }
-        }
-        if (!line.empty()) app.Log("[PY] " + line);
-        { std::lock_guard<std::mutex> lock(app.proc_mutex); CloseHandle(pi.hProcess); app.backend_process_handle = nullptr; }
-        CloseHandle(hChildOut_Rd);
-    }
-    else { app.Log("[ERR] Failed to start Python process."); }
-#else
-    int pipe_fd[2];
-    if (pipe(pipe_fd) == -1) { app.Log("[ERR] Pipe failed"); app.backend_running = false; return; }
-    pid_t pid = fork();
-    if (pid == -1) { app.Log("[ERR] Fork failed"); close(pipe_fd[0]); close(pipe_fd[1]); app.backend_running = false; return; }
-    if (pid == 0) {
-        close(pipe_fd[0]); dup2(pipe_fd[1], STDOUT_FILENO); dup2(pipe_fd[1], STDERR_FILENO); close(pipe_fd[1]);
-        execl(python_exe.c_str(), python_exe.c_str(), "-u", script_path.c_str(), (char*)NULL);
-        _exit(1);
-    }
-    else {
-        close(pipe_fd[1]);
-        { std::lock_guard<std::mutex> lock(app.proc_mutex); g_backend_pid = pid; }
-        char buffer[1024]; ssize_t bytesRead; std::string line_buffer;
-        while (app.is_running && (bytesRead = read(pipe_fd[0], buffer, sizeof(buffer) - 1)) > 0) {
-            buffer[bytesRead] = '\0';
-            for (int i = 0; i < bytesRead; i++) {
-                if (buffer[i] == '\n' || buffer[i] == '\r') { if (!line_buffer.empty()) { app.Log("[PY] " + line_buffer); line_buffer.clear(); } }
-                else { line_buffer.push_back(buffer[i]); }
+// --- 2. UI ---
+// CPU pinning and scheduling per thread role; running threads pick changes up on their next loop
+void RenderThreadsPanel(float dpi) {
+    ImGui::BeginChild("Threads", ImVec2(0, 265 * dpi), true);
+    ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.4f, 1.0f), "THREADS"); ImGui::Separator();
+    ImGui::Columns(3, nullptr, false); ImGui::SetColumnWidth(0, 90 * dpi); ImGui::SetColumnWidth(1, 110 * dpi);
+    for (int r = 0; r <= THREAD_ROLE_COUNT; r++) {
+        // The last row is the engine.py processes, taken at their next launch
+        int role = r < THREAD_ROLE_COUNT ? r : -1;
+        std::string name = role < 0 ? "engine" : kThreadRoleNames[role];
+        ThreadTuning t = app.Tuning(role);
+        ImGui::PushID(r);
+        ImGui::Text("%s", role < 0 ? "engine.py" : name.c_str()); ImGui::NextColumn();
+        char cpus[64]; snprintf(cpus, sizeof(cpus), "%s", FormatCpuList(t.cpus).c_str());
+        ImGui::SetNextItemWidth(-1);
+        if (ImGui::InputText("##cpus", cpus, sizeof(cpus), ImGuiInputTextFlags_EnterReturnsTrue) && !ApplySetting(name + "_cpus", cpus))
+            app.Log("[ERR] Bad CPU list for " + name + ": " + cpus);
+        ImGui::NextColumn();
+        ImGui::SetNextItemWidth(-1);
+        if (ImGui::BeginCombo("##priority", kThreadPriorityNames[t.priority])) {
+            for (int p = 0; p < THREAD_PRIORITY_COUNT; p++) {
+                if (ImGui::Selectable(kThreadPriorityNames[p], t.priority == p)) { t.priority = ThreadPriority(p); app.SetTuning(role, t); }
             }
+            ImGui::EndCombo();
         }
-        close(pipe_fd[0]); int status; waitpid(pid, &status, 0);
-        { std::lock_guard<std::mutex> lock(app.proc_mutex); g_backend_pid = -1; }
+        ImGui::NextColumn();
+        ImGui::PopID();
     }
-#endif
-    app.backend_running = false;
-    app.Log("[SYS] Backend Stopped.");
-}
-
-// --- 4. Logic Threads ---
-void InstallThreadFunc() {
-    app.is_installing = true;
-    app.install_progress = 0.0f;
-    app.Log("=== Installing Environment ===");
-#ifdef _WIN32
-    std::string sys_py = "python";
-#else
-    std::string sys_py = "python3";
-#endif
-    if (!ExecCommand(sys_py + " --version")) { app.Log("Error: System python not found."); app.is_installing = false; return; }
-    app.install_progress = 0.2f;
-    if (!ExecCommand(sys_py + " -m venv venv")) { app.Log("Error: Failed to create venv."); app.is_installing = false; return; }
-    app.install_progress = 0.4f;
-    fs::path cwd = fs::current_path();
-#ifdef _WIN32
-    std::string venv_pip = (cwd / "venv" / "Scripts" / "pip.exe").string();
-#else
-    std::string venv_pip = (cwd / "venv" / "bin" / "pip").string();
-#endif
-    std::string pip_cmd = "\"" + venv_pip + "\" install opencv-python pyzmq numpy mediapipe -i https://pypi.tuna.tsinghua.edu.cn/simple";
-    app.Log("Downloading packages...");
-    if (ExecCommand(pip_cmd)) { app.install_progress = 1.0f; app.install_status_text = "Success!"; app.Log("Environment Ready."); }
-    else { app.install_status_text = "Failed."; app.Log("Pip install failed."); }
-    app.is_installing = false;
-}
-
-void InstallDriverThread(std::string driverName) {
-    app.Log("Installing " + driverName + "...");
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-    app.Log(driverName + " Installed.");
+    ImGui::Columns(1);
+    ImGui::EndChild();
 }
 
-void CameraThread() {
-    zmq::context_t ctx(1);
-    zmq::socket_t publisher(ctx, zmq::socket_type::pub);
-    publisher.bind("tcp://*:" + std::to_string(app.port_pub_frames));
-    zmq::socket_t subscriber(ctx, zmq::socket_type::sub);
-    cv::VideoCapture cap;
-    int current_cam_idx = -1;
-    std::string current_zmq_addr = "";
-
-    while (app.is_running) {
-        if (!app.camera_active) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); app.status_cam_pub = false; continue; }
-        cv::Mat frame;
-        if (app.source_mode == SOURCE_LOCAL_CAM) {
-            if (current_cam_idx != app.selected_cam_index || !cap.isOpened()) {
-                cap.open(app.selected_cam_index);
-                current_cam_idx = app.selected_cam_index;
-                cap.set(cv::CAP_PROP_FRAME_WIDTH, 640);
-                cap.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
-            }
-            if (cap.isOpened()) cap >> frame;
-        }
-        else {
-            if (cap.isOpened()) cap.release();
-            if (current_zmq_addr != app.external_zmq_addr) {
-                try { subscriber.disconnect(current_zmq_addr); }
-                catch (...) {}
-                current_zmq_addr = app.external_zmq_addr;
-                subscriber.connect(current_zmq_addr); subscriber.set(zmq::sockopt::subscribe, "");
-            }
-            zmq::message_t msg;
-            if (subscriber.recv(msg, zmq::recv_flags::dontwait)) {
-                std::vector<uchar> data(static_cast<uchar*>(msg.data()), static_cast<uchar*>(msg.data()) + msg.size());
-                frame = cv::imdecode(data, cv::IMREAD_COLOR);
-            }
-        }
-        if (!frame.empty()) {
-            { std::lock_guard<std::mutex> lock(app.data_mutex); frame.copyTo(app.frame_raw); }
-            std::vector<uchar> buffer; cv::imencode(".jpg", frame, buffer, { cv::IMWRITE_JPEG_QUALITY, 50 });
-            std::string meta = "{}";
-            zmq::message_t msg_meta(meta.data(), meta.size()); zmq::message_t msg_payload(buffer.data(), buffer.size());
-            publisher.send(msg_meta, zmq::send_flags::sndmore); publisher.send(msg_payload, zmq::send_flags::none);
-            app.status_cam_pub = true;
-        }
-        else app.status_cam_pub = false;
-        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+void RenderPerformancePanel(float dpi) {
+    // Percentiles cover the last second: the difference of two cumulative snapshots
+    static LatencyHistogram::Snapshot prev[STAGE_COUNT], window[STAGE_COUNT], cur;
+    static uint64_t prev_counts[3] = {};
+    static float fps[3] = {};
+    static double last_t = 0.0;
+    double t = ImGui::GetTime();
+    if (t - last_t >= 1.0) {
+        for (int i = 0; i < STAGE_COUNT; i++) { app.latency[i].Read(cur); window[i] = cur.Since(prev[i]); prev[i] = cur; }
+        uint64_t counts[3] = { app.count_cam_frames, app.count_preview_frames, app.count_pose_packets };
+        for (int i = 0; i < 3; i++) { fps[i] = (float)((counts[i] - prev_counts[i]) / (t - last_t)); prev_counts[i] = counts[i]; }
+        last_t = t;
     }
-}
 
-void ReceiverThread() {
-    zmq::context_t ctx(1);
-    zmq::socket_t sub_img(ctx, zmq::socket_type::sub); sub_img.connect("tcp://127.0.0.1:" + std::to_string(app.port_sub_preview)); sub_img.set(zmq::sockopt::subscribe, "");
-    zmq::socket_t sub_pose(ctx, zmq::socket_type::sub); sub_pose.connect("tcp://127.0.0.1:" + std::to_string(app.port_sub_pose)); sub_pose.set(zmq::sockopt::subscribe, "");
-    zmq::pollitem_t items[] = { { sub_img, 0, ZMQ_POLLIN, 0 }, { sub_pose, 0, ZMQ_POLLIN, 0 } };
-    while (app.is_running) {
-        zmq::poll(items, 2, std::chrono::milliseconds(10));
-        if (items[0].revents & ZMQ_POLLIN) {
-            std::vector<zmq::message_t> msgs; zmq::recv_multipart(sub_img, std::back_inserter(msgs));
-            if (msgs.size() >= 2) {
-                std::vector<uchar> data(static_cast<uchar*>(msgs[1].data()), static_cast<uchar*>(msgs[1].data()) + msgs[1].size());
-                cv::Mat decoded = cv::imdecode(data, cv::IMREAD_COLOR);
-                if (!decoded.empty()) { std::lock_guard<std::mutex> lock(app.data_mutex); decoded.copyTo(app.frame_preview); }
-                app.status_prev_sub = true;
-            }
-        }
-        else app.status_prev_sub = false;
-        if (items[1].revents & ZMQ_POLLIN) {
-            std::vector<zmq::message_t> msgs; zmq::recv_multipart(sub_pose, std::back_inserter(msgs));
-            if (msgs.size() >= 2) {
-                float* raw = static_cast<float*>(msgs[1].data()); size_t count = msgs[1].size() / sizeof(float);
-                std::lock_guard<std::mutex> lock(app.data_mutex); app.pose_data.assign(raw, raw + count);
-                app.status_pose_sub = true;
-            }
+    ImGui::BeginChild("Performance", ImVec2(0, 320 * dpi), true);
+    ImGui::TextColored(ImVec4(0.8f, 0.6f, 1.0f, 1.0f), "PERFORMANCE"); ImGui::Separator();
+    ImGui::Text("Cam %.1f | Prev %.1f | Pose %.1f | UI %.0f fps", fps[0], fps[1], fps[2], ImGui::GetIO().Framerate);
+    int cap = app.ui_fps_cap;
+    if (ImGui::SliderInt("UI FPS cap", &cap, 0, 240, cap ? "%d" : "vsync")) app.ui_fps_cap = cap;
+    if (app.engine_kind == ENGINE_NATIVE) {
+        uint64_t batches = app.count_batches;
+        ImGui::Text("Batch avg %.2f | superseded %llu | stale %llu", batches ? (double)app.count_batched_frames / batches : 0.0,
+                    (unsigned long long)app.engine_frames.Superseded(), (unsigned long long)app.engine_frames.Stale());
+    }
+    if (app.roi.enabled) {
+        uint64_t frames = app.count_cam_frames;
+        ImGui::Text("ROI crops %.0f%% | avg %.0f kpx shipped", frames ? 100.0 * app.count_cropped_frames / frames : 0.0, frames ? app.count_shipped_pixels / 1000.0 / frames : 0.0);
+    }
+    ImGui::Spacing();
+    ImGui::Columns(4, nullptr, false); ImGui::SetColumnWidth(0, 150 * dpi);
+    ImGui::TextDisabled("Stage (ms)"); ImGui::NextColumn(); ImGui::TextDisabled("p50"); ImGui::NextColumn(); ImGui::TextDisabled("p95"); ImGui::NextColumn(); ImGui::TextDisabled("p99"); ImGui::NextColumn();
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        ImGui::Text("%s", kStageNames[i]); ImGui::NextColumn();
+        for (double q : { 0.50, 0.95, 0.99 }) {
+            if (window[i].total) ImGui::Text("%.1f", window[i].Percentile(q) / 1000.0);
+            else ImGui::TextDisabled("-");
+            ImGui::NextColumn();
         }
-        else app.status_pose_sub = false;
     }
+    ImGui::Columns(1);
+    ImGui::EndChild();
 }
 
-// --- 5. UI ---
 void RenderUI(float dpi) {
     const ImGuiViewport* viewport = ImGui::GetMainViewport();
     float left_w = 400.0f * dpi;
@@ -404,28 +163,123 @@ void RenderUI(float dpi) {
     ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
 
     // 1. Source
-    ImGui::BeginChild("Source", ImVec2(0, 260 * dpi), true); // Ӹ߶ѡ
+    ImGui::BeginChild("Source", ImVec2(0, ((app.roi.enabled ? 545 : 485) + (app.source_mode == SOURCE_REPLAY ? 50 : 0)) * dpi), true); // 增加高度容纳新选项
     ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.4f, 1.0f), "SOURCE"); ImGui::Separator();
     if (ImGui::RadioButton("Local Cam", app.source_mode == SOURCE_LOCAL_CAM)) app.source_mode = SOURCE_LOCAL_CAM;
     ImGui::SameLine(); if (ImGui::RadioButton("External ZMQ", app.source_mode == SOURCE_EXTERNAL_ZMQ)) app.source_mode = SOURCE_EXTERNAL_ZMQ;
+    ImGui::SameLine(); if (ImGui::RadioButton("Replay", app.source_mode == SOURCE_REPLAY)) app.source_mode = SOURCE_REPLAY;
     ImGui::Spacing();
 
-    // [] Ԥ
+    // [新增] 预览开关
     ImGui::Checkbox("Show Previews (Reduce GPU)", &app.show_previews);
+    // Off: the engine skips drawing and JPEG encoding, the skeleton is drawn here over the raw frame
+    bool engine_preview = app.engine_preview;
+    ImGui::BeginDisabled(!app.show_previews);
+    if (ImGui::Checkbox("Engine Preview", &engine_preview)) app.engine_preview = engine_preview;
+    ImGui::EndDisabled();
+    bool roi = app.roi.enabled;
+    if (ImGui::Checkbox("Crop to Person (ROI)", &roi)) app.roi.enabled = roi;
+    if (roi) {
+        float padding = app.roi.padding;
+        if (ImGui::SliderFloat("Padding", &padding, 0.0f, 1.0f, "%.2f")) app.roi.padding = padding;
+        int keyframe = app.roi.keyframe_interval;
+        if (ImGui::SliderInt("Keyframe Every", &keyframe, 0, 120)) app.roi.keyframe_interval = keyframe;
+    }
     ImGui::Spacing();
 
     if (app.source_mode == SOURCE_LOCAL_CAM) {
-        if (ImGui::Button("Scan Cams", ImVec2(-1, 30 * dpi))) RefreshCameraList();
-        if (!app.available_cams.empty()) {
-            std::string preview = "Cam " + std::to_string(app.selected_cam_index);
-            if (ImGui::BeginCombo("##Sel", preview.c_str())) {
-                for (int idx : app.available_cams) { if (ImGui::Selectable(("Cam " + std::to_string(idx)).c_str(), app.selected_cam_index == idx)) app.selected_cam_index = idx; }
-                ImGui::EndCombo();
+        bool scanning = app.cams_scanning;
+        if (scanning) ImGui::BeginDisabled();
+        if (ImGui::Button(scanning ? "Scanning..." : "Scan Cams", ImVec2(-1, 30 * dpi))) RefreshCameraList();
+        if (scanning) ImGui::EndDisabled();
+        std::vector<CameraInfo> devices = app.Cameras();
+        if (!devices.empty()) {
+            // Every checked camera gets its own capture worker
+            std::vector<int> cams = app.SelectedCams();
+            for (const CameraInfo& dev : devices) {
+                int idx = dev.index;
+                bool on = std::find(cams.begin(), cams.end(), idx) != cams.end();
+                std::string label = std::to_string(idx) + ": " + (dev.name.empty() ? "Camera" : dev.name);
+                if (ImGui::Checkbox(label.c_str(), &on)) {
+                    if (on) cams.push_back(idx); else cams.erase(std::find(cams.begin(), cams.end(), idx));
+                    app.SetSelectedCams(cams);
+                }
+            }
+            if (cams.size() > 1) {
+                std::string shown = "Cam " + std::to_string(app.preview_cam);
+                if (ImGui::BeginCombo("View", shown.c_str())) {
+                    for (int idx : cams) { if (ImGui::Selectable(("Cam " + std::to_string(idx)).c_str(), app.preview_cam == idx)) app.preview_cam = idx; }
+                    ImGui::EndCombo();
+                }
+            }
+            // Device mode of the shown camera; the worker reopens it on change
+            if (!cams.empty()) {
+                int cam = cams.size() > 1 ? app.preview_cam.load() : cams[0];
+                CaptureFormat fmt = app.CameraFormat(cam);
+                bool changed = false;
+                // Choices come from the enumerated modes, narrowed by the picked pixel format
+                // and size; presets when the device reported none
+                std::vector<std::string> fourccs{ "" }, sizes;
+                std::vector<int> rates{ 0 };
+                auto add = [](auto& list, const auto& v) { if (std::find(list.begin(), list.end(), v) == list.end()) list.push_back(v); };
+                for (const CameraInfo& dev : devices) {
+                    if (dev.index != cam) continue;
+                    for (const CameraMode& m : dev.modes) {
+                        add(fourccs, m.fourcc);
+                        if (!fmt.fourcc.empty() && m.fourcc != fmt.fourcc) continue;
+                        add(sizes, std::to_string(m.width) + "x" + std::to_string(m.height));
+                        if (m.width == fmt.width && m.height == fmt.height && m.fps > 0) add(rates, (int)(m.fps + 0.5f));
+                    }
+                }
+                if (sizes.empty()) sizes = { "640x480", "1280x720", "1920x1080" };
+                if (rates.size() == 1) rates = { 0, 30, 60 };
+                if (fourccs.size() == 1) fourccs = { "", "MJPG", "YUYV" };
+                std::string size = std::to_string(fmt.width) + "x" + std::to_string(fmt.height);
+                if (ImGui::BeginCombo("Resolution", size.c_str())) {
+                    for (const std::string& name : sizes) {
+                        int w = 0, h = 0;
+                        if (ImGui::Selectable(name.c_str(), name == size) && sscanf(name.c_str(), "%dx%d", &w, &h) == 2) { fmt.width = w; fmt.height = h; changed = true; }
+                    }
+                    ImGui::EndCombo();
+                }
+                if (ImGui::BeginCombo("FPS", fmt.fps ? std::to_string(fmt.fps).c_str() : "default")) {
+                    for (int r : rates) { if (ImGui::Selectable(r ? std::to_string(r).c_str() : "default", fmt.fps == r)) { fmt.fps = r; changed = true; } }
+                    ImGui::EndCombo();
+                }
+                if (ImGui::BeginCombo("Pixel Format", fmt.fourcc.empty() ? "default" : fmt.fourcc.c_str())) {
+                    for (const std::string& cc : fourccs) { if (ImGui::Selectable(cc.empty() ? "default" : cc.c_str(), fmt.fourcc == cc)) { fmt.fourcc = cc; changed = true; } }
+                    ImGui::EndCombo();
+                }
+                if (changed) app.SetCameraFormat(cam, fmt);
+                bool passthrough = app.mjpeg_passthrough;
+                if (ImGui::Checkbox("MJPEG Passthrough", &passthrough)) { app.mjpeg_passthrough = passthrough; app.formats_generation++; }
             }
         }
     }
+    else if (app.source_mode == SOURCE_REPLAY) {
+        // Taken on Enter; a running replay switches to the new file
+        char replay[260]; snprintf(replay, sizeof(replay), "%s", app.replay_path.c_str());
+        if (ImGui::InputText("Recording", replay, sizeof(replay), ImGuiInputTextFlags_EnterReturnsTrue)) app.replay_path = replay;
+        float speed = app.replay_speed;
+        if (ImGui::SliderFloat("Speed", &speed, 0.0f, 4.0f, speed > 0.0f ? "%.2fx" : "max")) app.replay_speed = speed;
+        bool loop = app.replay_loop;
+        if (ImGui::Checkbox("Loop", &loop)) app.replay_loop = loop;
+    }
     else { char buf[128]; strcpy(buf, app.external_zmq_addr.c_str()); if (ImGui::InputText("ZMQ Addr", buf, 128)) app.external_zmq_addr = std::string(buf); }
     ImGui::Spacing();
+    // Frames as published plus the poses that come back, for replay and offline comparison
+    static char record[260] = "posebridge.pbrec";
+    if (app.recorder.Active()) {
+        ImGui::Text("Recording: %llu records, %.1f MB", (unsigned long long)app.recorder.Records(), app.recorder.Bytes() / 1048576.0);
+        if (ImGui::Button("Stop Recording", ImVec2(-1, 0))) app.recorder.Close();
+    }
+    else {
+        ImGui::InputText("##record", record, sizeof(record)); ImGui::SameLine();
+        if (ImGui::Button("Record")) {
+            if (app.recorder.Open(record)) app.Log(std::string("[SYS] Recording to ") + record);
+            else app.Log(std::string("[ERR] Cannot write recording: ") + record);
+        }
+    }
     if (app.camera_active) {
         ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.6f, 0.2f, 0.2f, 1.0f));
         if (ImGui::Button("STOP STREAM", btn_size)) app.camera_active = false;
@@ -439,37 +293,147 @@ void RenderUI(float dpi) {
     ImGui::EndChild();
 
     // 2. Backend
-    ImGui::BeginChild("Backend", ImVec2(0, 220 * dpi), true);
+    ImGui::BeginChild("Backend", ImVec2(0, 345 * dpi), true);
     ImGui::TextColored(ImVec4(0.4f, 0.8f, 1.0f, 1.0f), "BACKEND"); ImGui::Separator();
     bool venv = fs::exists(fs::current_path() / "venv");
     ImGui::Text("Venv: %s", venv ? "Yes" : "No");
     if (app.is_installing) { ImGui::ProgressBar(app.install_progress, ImVec2(-1, 20 * dpi)); ImGui::Text("%s", app.install_status_text.c_str()); }
     else { if (ImGui::Button(venv ? "Reinstall Libs" : "Create Env", ImVec2(-1, 30 * dpi))) std::thread(InstallThreadFunc).detach(); }
     ImGui::Spacing();
-    if (!venv) ImGui::BeginDisabled();
+    bool native = app.engine_kind == ENGINE_NATIVE;
+    if (app.backend_running) ImGui::BeginDisabled();
+    ImGui::Text("Engine:"); ImGui::SameLine();
+    if (ImGui::RadioButton("engine.py", !native)) app.engine_kind = ENGINE_PYTHON;
+    ImGui::SameLine(); if (ImGui::RadioButton("Native", native)) app.engine_kind = ENGINE_NATIVE;
+    if (native) {
+        NativeEngineConfig& cfg = app.native_engine;
+        char model[260]; snprintf(model, sizeof(model), "%s", cfg.model_path.c_str());
+        if (ImGui::InputText("Model", model, sizeof(model))) cfg.model_path = model;
+        if (ImGui::BeginCombo("Provider", kProviderNames[cfg.provider])) {
+            for (int i = 0; i < PROVIDER_COUNT; i++) {
+                if (!ProviderAvailable(InferenceProvider(i))) ImGui::BeginDisabled();
+                if (ImGui::Selectable(kProviderNames[i], cfg.provider == i)) cfg.provider = InferenceProvider(i);
+                if (!ProviderAvailable(InferenceProvider(i))) ImGui::EndDisabled();
+            }
+            ImGui::EndCombo();
+        }
+        if (ImGui::BeginCombo("Format", kModelFormatNames[cfg.format])) {
+            for (int i = 0; i < 2; i++) { if (ImGui::Selectable(kModelFormatNames[i], cfg.format == i)) cfg.format = PoseModelFormat(i); }
+            ImGui::EndCombo();
+        }
+        if (ImGui::BeginCombo("Preprocess", kPreprocessNames[cfg.preprocess])) {
+            for (int i = 0; i < PREPROCESS_DEVICE_COUNT; i++) {
+                if (!PreprocessAvailable(PreprocessDevice(i))) ImGui::BeginDisabled();
+                if (ImGui::Selectable(kPreprocessNames[i], cfg.preprocess == i)) cfg.preprocess = PreprocessDevice(i);
+                if (!PreprocessAvailable(PreprocessDevice(i))) ImGui::EndDisabled();
+            }
+            ImGui::EndCombo();
+        }
+    }
+    else {
+        bool standby = app.engine_standby;
+        if (ImGui::Checkbox("Warm standby", &standby)) app.engine_standby = standby;
+        ImGui::SameLine();
+        bool ipc = app.engine_ipc && IpcSupported();
+        if (!IpcSupported()) ImGui::BeginDisabled();
+        if (ImGui::Checkbox("Local IPC", &ipc)) app.engine_ipc = ipc;
+        if (!IpcSupported()) ImGui::EndDisabled();
+    }
+    if (app.backend_running) ImGui::EndDisabled();
+    if (!native && app.backend_running) {
+        ImGui::SameLine(); DrawStatusDot(app.standby_ready);
+        ImGui::SameLine(); ImGui::Text("failovers %llu", (unsigned long long)app.engine_failovers);
+    }
+    // The native engine needs no venv
+    bool can_launch = native || venv;
+    if (!can_launch) ImGui::BeginDisabled();
     if (app.backend_running) {
         ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.7f, 0.2f, 0.2f, 1.0f)); ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.8f, 0.2f, 0.2f, 1.0f));
         if (ImGui::Button("STOP ENGINE", btn_size)) StopBackend();
         ImGui::PopStyleColor(2);
     }
     else {
-        if (ImGui::Button("LAUNCH ENGINE", btn_size)) std::thread(BackendMonitorThread, GetPythonPath(), app.python_script).detach();
+        if (ImGui::Button("LAUNCH ENGINE", btn_size)) StartEngine(GetPythonPath());
+    }
+    if (!can_launch) ImGui::EndDisabled();
+    ImGui::Text("Frames:"); ImGui::SameLine();
+    if (ImGui::RadioButton("JPEG", app.frame_transport == TRANSPORT_JPEG)) app.frame_transport = TRANSPORT_JPEG;
+    ImGui::SameLine(); if (ImGui::RadioButton("Shared Mem (local)", app.frame_transport == TRANSPORT_SHM)) app.frame_transport = TRANSPORT_SHM;
+    if (ImGui::BeginCombo("JPEG Codec", kJpegBackendNames[app.jpeg_backend])) {
+        for (int i = 0; i < JPEG_BACKEND_COUNT; i++) {
+            // Backends that were not compiled in stay listed but disabled
+            if (!JpegBackendAvailable(JpegBackend(i))) ImGui::BeginDisabled();
+            if (ImGui::Selectable(kJpegBackendNames[i], app.jpeg_backend == i)) app.jpeg_backend = JpegBackend(i);
+            if (!JpegBackendAvailable(JpegBackend(i))) ImGui::EndDisabled();
+        }
+        ImGui::EndCombo();
     }
-    if (!venv) ImGui::EndDisabled();
     ImGui::EndChild();
 
     // 3. Status
-    ImGui::BeginChild("Status", ImVec2(0, 0), true);
+    ImGui::BeginChild("Status", ImVec2(0, (app.pose_filters.enabled ? 505 : 425) * dpi), true);
     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "STATUS"); ImGui::Separator();
-    if (ImGui::Button("Install OpenVR", ImVec2(-1, 30 * dpi))) std::thread(InstallDriverThread, "OpenVR").detach();
-    if (ImGui::Button("Install ROS", ImVec2(-1, 30 * dpi))) std::thread(InstallDriverThread, "ROS").detach();
-    ImGui::Spacing();
+    // Pose outputs: a target is applied on Enter, which restarts that sink
+    ImGui::Columns(3, nullptr, false); ImGui::SetColumnWidth(0, 100 * dpi); ImGui::SetColumnWidth(1, 180 * dpi);
+    for (int k = 0; k < SINK_COUNT; k++) {
+        PoseSinkKind kind = PoseSinkKind(k);
+        ImGui::PushID(k);
+        if (!PoseSinkAvailable(kind)) ImGui::BeginDisabled();
+        bool on = app.outputs.Enabled(kind);
+        if (ImGui::Checkbox(kPoseSinkNames[k], &on)) app.outputs.SetEnabled(kind, on);
+        ImGui::NextColumn();
+        char target[128]; snprintf(target, sizeof(target), "%s", app.outputs.Target(kind).c_str());
+        ImGui::SetNextItemWidth(-1);
+        if (ImGui::InputText("##target", target, sizeof(target), ImGuiInputTextFlags_EnterReturnsTrue)) app.outputs.SetTarget(kind, target);
+        if (!PoseSinkAvailable(kind)) ImGui::EndDisabled();
+        ImGui::NextColumn();
+        DrawStatusDot(app.outputs.Active(kind)); ImGui::SameLine();
+        if (app.outputs.Failed(kind)) ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "failed");
+        else ImGui::Text("%llu (-%llu)", (unsigned long long)app.outputs.Sent(kind), (unsigned long long)app.outputs.Dropped(kind));
+        ImGui::NextColumn();
+        ImGui::PopID();
+    }
+    ImGui::Columns(1);
+    bool filter = app.pose_filters.enabled;
+    if (ImGui::Checkbox("Smooth + predict outputs", &filter)) app.pose_filters.enabled = filter;
+    if (filter) {
+        PoseFilterParams p = app.pose_filters.Params();
+        bool changed = ImGui::SliderFloat("Min cutoff Hz", &p.min_cutoff, 0.05f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+        changed |= ImGui::SliderFloat("Beta", &p.beta, 0.0f, 10.0f, "%.2f");
+        if (changed) app.pose_filters.SetParams(p);
+        float lead_ms = app.pose_filters.lead_us / 1000.0f;
+        if (ImGui::SliderFloat("Lead ms", &lead_ms, 0.0f, 100.0f, "%.0f")) app.pose_filters.lead_us = int64_t(lead_ms * 1000.0f);
+    }
+    ImGui::Separator();
     ImGui::Columns(2, nullptr, false); ImGui::SetColumnWidth(0, 220 * dpi);
-    ImGui::Text("Cam Pub (%d)", app.port_pub_frames); ImGui::NextColumn(); DrawStatusDot(app.status_cam_pub); ImGui::NextColumn();
-    ImGui::Text("Prev Sub (%d)", app.port_sub_preview); ImGui::NextColumn(); DrawStatusDot(app.status_prev_sub); ImGui::NextColumn();
-    ImGui::Text("Pose Sub (%d)", app.port_sub_pose); ImGui::NextColumn(); DrawStatusDot(app.status_pose_sub);
+    ImGui::Text("Cam Pub %s", app.frames_endpoint.c_str()); ImGui::NextColumn(); DrawStatusDot(app.status_cam_pub); ImGui::NextColumn();
+    ImGui::Text("Prev Sub %s", app.preview_endpoint.c_str()); ImGui::NextColumn(); DrawStatusDot(app.status_prev_sub); ImGui::NextColumn();
+    ImGui::Text("Pose Sub %s", app.pose_endpoint.c_str()); ImGui::NextColumn(); DrawStatusDot(app.status_pose_sub);
+    ImGui::Columns(1);
+    ImGui::Separator();
+    // Load shedding per channel; frames also counts the engine's own drops
+    ImGui::Columns(3, nullptr, false); ImGui::SetColumnWidth(0, 100 * dpi); ImGui::SetColumnWidth(1, 150 * dpi);
+    ImGui::TextDisabled("Channel"); ImGui::NextColumn(); ImGui::TextDisabled("Policy"); ImGui::NextColumn(); ImGui::TextDisabled("Dropped"); ImGui::NextColumn();
+    for (int c = 0; c < CHANNEL_COUNT; c++) {
+        ImGui::Text("%s", kChannelNames[c]); ImGui::NextColumn();
+        ImGui::PushID(c); ImGui::SetNextItemWidth(-1);
+        if (ImGui::BeginCombo("##policy", kDeliveryPolicyNames[app.delivery[c].policy])) {
+            for (int p = 0; p < DELIVERY_POLICY_COUNT; p++) { if (ImGui::Selectable(kDeliveryPolicyNames[p], app.delivery[c].policy == p)) app.delivery[c].policy = DeliveryPolicy(p); }
+            ImGui::EndCombo();
+        }
+        ImGui::PopID(); ImGui::NextColumn();
+        if (c == CHANNEL_FRAMES) ImGui::Text("%llu (+%llu engine)", (unsigned long long)app.dropped[c], (unsigned long long)app.engine_dropped);
+        else ImGui::Text("%llu", (unsigned long long)app.dropped[c]);
+        ImGui::NextColumn();
+    }
     ImGui::Columns(1);
     ImGui::EndChild();
+
+    // 4. Performance
+    RenderPerformancePanel(dpi);
+
+    // 5. Threads
+    RenderThreadsPanel(dpi);
     ImGui::End();
 
     // Right Panel
@@ -477,24 +441,36 @@ void RenderUI(float dpi) {
     ImGui::SetNextWindowSize(ImVec2(viewport->WorkSize.x - left_w, viewport->WorkSize.y));
     ImGui::Begin("Debug", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
 
-    // [޸] ֻпؿʱִϴͻ
+    // [修改] 只有开关开启时才执行纹理上传和绘制
     if (app.show_previews) {
         float img_h = viewport->WorkSize.y * 0.6f;
         ImGui::BeginChild("Images", ImVec2(0, img_h), false);
         ImGui::BeginGroup();
-        { std::lock_guard<std::mutex> lock(app.data_mutex); UpdateTexture(app.tex_raw, app.frame_raw); }
-        float hw = ImGui::GetContentRegionAvail().x * 0.5f - 10;
-        if (app.tex_raw) { float ar = (float)app.frame_raw.cols / std::max(1.0f, (float)app.frame_raw.rows); ImGui::Image((ImTextureID)(intptr_t)app.tex_raw, ImVec2(hw, hw / ar)); }
-        else ImGui::Dummy(ImVec2(hw, 200));
-        ImGui::EndGroup(); ImGui::SameLine();
-        ImGui::BeginGroup();
-        { std::lock_guard<std::mutex> lock(app.data_mutex); UpdateTexture(app.tex_preview, app.frame_preview); }
-        if (app.tex_preview) { float ar = (float)app.frame_preview.cols / std::max(1.0f, (float)app.frame_preview.rows); ImGui::Image((ImTextureID)(intptr_t)app.tex_preview, ImVec2(hw, hw / ar)); }
+        TripleBuffer<FrameSlot>& raw_frames = app.raw_frames[app.PreviewSource()];
+        raw_frames.Update();
+        UpdateTexture(ui.tex_raw, raw_frames.ReadBuffer(), STAGE_TEXTURE_RAW);
+        bool engine_view = app.EnginePreviewWanted();
+        float hw = engine_view ? ImGui::GetContentRegionAvail().x * 0.5f - 10 : ImGui::GetContentRegionAvail().x;
+        if (ui.tex_raw.Texture()) {
+            float ar = (float)ui.tex_raw.Width() / std::max(1.0f, (float)ui.tex_raw.Height());
+            ImGui::Image((ImTextureID)(intptr_t)ui.tex_raw.Texture(), ImVec2(hw, hw / ar));
+            if (!engine_view) DrawPoseOverlay();
+        }
         else ImGui::Dummy(ImVec2(hw, 200));
-        ImGui::EndGroup(); ImGui::EndChild();
+        ImGui::EndGroup();
+        if (engine_view) {
+            ImGui::SameLine();
+            ImGui::BeginGroup();
+            app.preview_frames.Update();
+            UpdateTexture(ui.tex_preview, app.preview_frames.ReadBuffer(), STAGE_TEXTURE_PREVIEW);
+            if (ui.tex_preview.Texture()) { float ar = (float)ui.tex_preview.Width() / std::max(1.0f, (float)ui.tex_preview.Height()); ImGui::Image((ImTextureID)(intptr_t)ui.tex_preview.Texture(), ImVec2(hw, hw / ar)); }
+            else ImGui::Dummy(ImVec2(hw, 200));
+            ImGui::EndGroup();
+        }
+        ImGui::EndChild();
     }
     else {
-        // رԤʱʾռλʾ
+        // 关闭预览时显示的占位提示
         ImGui::BeginChild("ImagesPlaceholder", ImVec2(0, viewport->WorkSize.y * 0.1f));
         ImGui::TextDisabled("--- Previews Hidden (Reduced GPU Load) ---");
         ImGui::EndChild();
@@ -503,14 +479,25 @@ void RenderUI(float dpi) {
     ImGui::Separator();
     ImGui::BeginChild("Log", ImVec2(0, 0), true);
     ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.02f, 0.02f, 0.02f, 1.0f));
-    std::lock_guard<std::mutex> lock(app.log_mutex);
-    for (const auto& l : app.logs) {
-        ImVec4 c = ImVec4(0.8f, 0.8f, 0.8f, 1.0f);
-        if (l.find("Error") != std::string::npos) c = ImVec4(1, 0.4f, 0.4f, 1);
-        else if (l.find("[PY]") != std::string::npos) c = ImVec4(0.6f, 0.8f, 1, 1);
-        ImGui::TextColored(c, "%s", l.c_str());
+    // Only the visible lines are copied out of the ring and formatted
+    uint64_t first = app.logs.Begin(), end = app.logs.End();
+    ImGuiListClipper clipper;
+    clipper.Begin((int)(end - first));
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            LogRecord r;
+            if (!app.logs.Read(first + i, r)) { ImGui::TextUnformatted(""); continue; }
+            ImVec4 c = ImVec4(0.8f, 0.8f, 0.8f, 1.0f);
+            if (r.level == LOG_ERROR) c = ImVec4(1, 0.4f, 0.4f, 1);
+            else if (r.level == LOG_WARN) c = ImVec4(1, 0.8f, 0.3f, 1);
+            else if (r.source == LOG_ENGINE) c = ImVec4(0.6f, 0.8f, 1, 1);
+            char stamp[9];
+            FormatLogTime(r.time, stamp);
+            ImGui::TextColored(c, "[%s] %s%.*s", stamp, r.source == LOG_ENGINE ? "[PY] " : "", (int)r.length, r.text);
+        }
     }
-    if (app.scroll_to_bottom) { ImGui::SetScrollHereY(1.0f); app.scroll_to_bottom = false; }
+    clipper.End();
+    if (app.scroll_to_bottom.exchange(false)) ImGui::SetScrollHereY(1.0f);
     ImGui::PopStyleColor(); ImGui::EndChild(); ImGui::End();
 }
 
@@ -543,15 +530,34 @@ int main(int, char**) {
     GLFWwindow* w = glfwCreateWindow(1280, 768, "Pose Bridge", NULL, NULL);
     if (!w) return 1;
     glfwMakeContextCurrent(w);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return 1;
     glfwSwapInterval(1);
     float xs, ys; glfwGetWindowContentScale(w, &xs, &ys); float dpi = xs > 0.0f ? xs : 1.0f;
     IMGUI_CHECKVERSION(); ImGui::CreateContext(); ImGui::StyleColorsDark(); ImGui::GetStyle().ScaleAllSizes(dpi);
     LoadScaledFont(dpi);
     ImGui_ImplGlfw_InitForOpenGL(w, true); ImGui_ImplOpenGL3_Init(glsl_version);
     RefreshCameraList();
-    std::thread t1(CameraThread), t2(ReceiverThread);
+    std::thread t1(CameraThread), t2(ReceiverThread), t3(PoseOutputThread);
+    // Sleep until input, a new frame of a shown stream (app.WakeUi) or the idle
+    // refresh; capped at ui_fps_cap and close to idle while minimized
+    app.ui_wake = glfwPostEmptyEvent;
+    double last_frame = 0.0;
+    int follow_up = 0; // one more frame after input so hover/active states settle
+    ThreadTuner tuner(ROLE_UI);
     while (!glfwWindowShouldClose(w)) {
-        glfwPollEvents(); ImGui_ImplOpenGL3_NewFrame(); ImGui_ImplGlfw_NewFrame(); ImGui::NewFrame();
+        tuner.Poll();
+        if (glfwGetWindowAttrib(w, GLFW_ICONIFIED)) { glfwWaitEventsTimeout(1.0); continue; }
+        int cap = app.ui_fps_cap;
+        double since = glfwGetTime() - last_frame;
+        if (cap > 0 && since < 1.0 / cap) std::this_thread::sleep_for(std::chrono::duration<double>(1.0 / cap - since));
+        if (follow_up > 0) { follow_up--; glfwPollEvents(); }
+        else {
+            double deadline = last_frame + 1.0 / std::max(1, app.ui_idle_fps.load());
+            glfwWaitEventsTimeout(std::max(0.0, deadline - glfwGetTime()));
+            if (!app.ui_frame_ready.exchange(false) && glfwGetTime() < deadline) follow_up = 1;
+        }
+        last_frame = glfwGetTime();
+        ImGui_ImplOpenGL3_NewFrame(); ImGui_ImplGlfw_NewFrame(); ImGui::NewFrame();
         RenderUI(dpi);
         ImGui::Render();
         int dw, dh; glfwGetFramebufferSize(w, &dw, &dh); glViewport(0, 0, dw, dh);
@@ -559,7 +565,10 @@ int main(int, char**) {
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(w);
     }
-    app.is_running = false; if (t1.joinable()) t1.join(); if (t2.joinable()) t2.join();
+    app.ui_wake = nullptr;
+    StopBackend();
+    app.is_running = false; JoinEngine(); if (t1.joinable()) t1.join(); if (t2.joinable()) t2.join(); if (t3.joinable()) t3.join(); WaitCameraScan(); app.recorder.Close();
+    ui.tex_raw.Release(); ui.tex_preview.Release();
     ImGui_ImplOpenGL3_Shutdown(); ImGui_ImplGlfw_Shutdown(); ImGui::DestroyContext();
     glfwDestroyWindow(w); glfwTerminate();
     return 0;
@@ -0,0 +1,676 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <zmq.hpp>
+#include <zmq_addon.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "app_state.h"
+#include "clock.h"
+#include "delivery.h"
+#include "frame_pool.h"
+#include "frame_sync.h"
+#include "recording.h"
+#include "shm_ring.h"
+#include "stage_queue.h"
+#include "zmq_context.h"
+
+static_assert(kMaxSources + 1 <= kMaxChannelStreams, "channel HWMs leave room for every source and sync");
+
+int64_t JsonInt(std::string_view json, std::string_view key, int64_t fallback) {
+    size_t pos = 0;
+    while ((pos = json.find(key, pos)) != std::string_view::npos) {
+        size_t end = pos + key.size();
+        bool quoted = pos > 0 && json[pos - 1] == '"' && end < json.size() && json[end] == '"';
+        pos = end;
+        if (!quoted) continue;
+        size_t v = json.find_first_not_of(" \t:", end + 1);
+        if (v == std::string_view::npos) break;
+        int64_t out = fallback;
+        std::from_chars(json.data() + v, json.data() + json.size(), out);
+        return out;
+    }
+    return fallback;
+}
+
+// Capture -> encode -> publish run as separate stages, so a slow imencode or
+// send never delays the next grab. Every source gets its own capture and
+// encode thread; all of them feed one publisher.
+struct CapturedFrame {
+    cv::Mat image;          // the whole sensor frame, or a view of its ROI crop
+    uint64_t seq = 0;       // frame_id echoed back in the pose packet
+    int64_t capture_us = 0;
+    cv::Rect crop;          // empty unless `image` is a crop
+    cv::Size full;
+    cv::Mat jpeg;           // the camera's own JPEG, forwarded as is; `image` may then be empty
+};
+
+struct EncodedFrame {
+    std::string topic;
+    BufferPool::Handle meta;    // JSON
+    BufferPool::Handle payload; // JPEG; null for shm frames
+    uint64_t frame_id = 0;
+    int source_id = 0;
+    int64_t capture_us = 0;
+    int64_t encode_us = 0;
+    cv::Mat raw;            // shm frames only, kept for the recorder
+};
+
+// One capture source: local device N (topic "camN"), the external ZMQ feed ("ext", source 0),
+// or recorded source N ("camN")
+struct SourceWorker {
+    int source_id = 0;
+    DataSourceMode mode = SOURCE_LOCAL_CAM;
+    std::shared_ptr<const RecordingReader> replay; // SOURCE_REPLAY
+    std::string topic;
+    StageQueue<CapturedFrame> q_encode{ 1 }; // latest frame wins if the encoder falls behind
+    FramePool frames; // capture thread only
+    std::atomic<bool> stop{ false };
+    std::thread capture, encoder;
+};
+
+// Sources currently running, read by the encoders and the frame-sync stage
+struct SourceSet {
+    std::mutex mutex;
+    std::vector<int> ids;
+    uint64_t generation = 0;
+    std::atomic<bool> grouped{ false }; // more than one source: frames are grouped for multi-view
+};
+
+// Metadata and payloads of published frames. Never destroyed: ZMQ's IO threads
+// may still hand buffers back while the process exits.
+static BufferPool& PayloadPool() {
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+// Zero-copy: the buffer returns to its pool once ZMQ is done with it
+static zmq::message_t PooledMessage(BufferPool::Handle buffer) {
+    if (!buffer || buffer->bytes.empty()) return zmq::message_t();
+    BufferPool::Buffer* b = buffer.release();
+    return zmq::message_t(b->bytes.data(), b->bytes.size(), BufferPool::FreeMessage, b);
+}
+
+// Metadata JSON is appended in place, without string temporaries
+static void Append(std::vector<uint8_t>& out, std::string_view s) { out.insert(out.end(), s.begin(), s.end()); }
+template <typename Int>
+static void AppendInt(std::vector<uint8_t>& out, Int v) {
+    char buf[24];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.insert(out.end(), buf, r.ptr);
+}
+
+// Decodes into a pooled frame of the JPEG's size
+static bool DecodePooled(SourceWorker& w, JpegCodec& codec, const void* data, size_t size, cv::Mat& out) {
+    int width, height;
+    out = JpegImageSize(data, size, width, height) ? w.frames.Acquire(height, width, CV_8UC3) : cv::Mat();
+    return codec.Decode(data, size, out);
+}
+
+// Pooled copy of a compressed frame whose buffer is about to be reused (device, message, mapping)
+static cv::Mat PooledBytes(SourceWorker& w, const void* data, size_t size) {
+    cv::Mat out = w.frames.AcquireBytes(size);
+    std::memcpy(out.data, data, size);
+    return out;
+}
+
+// A source's compressed frames can go out untouched only to engine.py over JPEG, uncropped
+static bool CanForwardJpeg() {
+    return app.engine_kind == ENGINE_PYTHON && app.frame_transport == TRANSPORT_JPEG && !app.roi.enabled;
+}
+
+// Whether this source's decoded frame is needed for anything but the engine
+static bool PreviewWanted(const SourceWorker& w) {
+    return app.show_previews && app.PreviewSource() == w.source_id;
+}
+
+// `jpeg`, if given, is forwarded instead of encoding `frame`; `frame` may then be empty (no preview)
+static void SubmitFrame(SourceWorker& w, const cv::Mat& frame, int64_t capture_us, const cv::Mat& jpeg = cv::Mat()) {
+    uint64_t frame_id = ++app.next_frame_id;
+    app.latency[STAGE_CAPTURE].Record(WallClockMicros() - capture_us);
+    app.count_cam_frames++;
+    FrameTimeline& tl = app.Timeline(frame_id);
+    tl.frame_id = frame_id; tl.capture_us = capture_us; tl.encode_us = 0; tl.publish_us = 0;
+    // frame is never written after capture, so the UI and the encoder can share its buffer
+    TripleBuffer<FrameSlot>& raw_frames = app.raw_frames[w.source_id];
+    if (!frame.empty()) { FrameSlot& raw = raw_frames.WriteBuffer(); raw.image = frame; raw.seq = frame_id; raw.capture_us = capture_us; raw_frames.Publish(); if (w.source_id == app.PreviewSource()) app.WakeUi(); }
+    if (!jpeg.empty()) {
+        app.count_passthrough_frames++;
+        if (!w.q_encode.Push(CapturedFrame{ frame, frame_id, capture_us, cv::Rect(), frame.size(), jpeg })) app.dropped[CHANNEL_FRAMES]++;
+        return;
+    }
+    // Past this point only the person's region travels on; the UI keeps the whole frame
+    cv::Rect crop = app.roi_trackers[w.source_id].Next(frame.size(), app.roi);
+    bool cropped = crop.size() != frame.size();
+    cv::Mat shipped = cropped ? frame(crop) : frame;
+    if (cropped) app.count_cropped_frames++; else crop = cv::Rect();
+    app.count_shipped_pixels += shipped.total();
+    // The in-process engine takes the Mat as is; encoding and publishing are only for engine.py
+    if (app.engine_kind == ENGINE_NATIVE) { if (app.backend_running) app.engine_frames.Push(EngineFrame{ shipped, frame_id, capture_us, w.source_id, crop, frame.size() }); }
+    else if (!w.q_encode.Push(CapturedFrame{ shipped, frame_id, capture_us, crop, frame.size() })) app.dropped[CHANNEL_FRAMES]++;
+}
+
+// Applies the configured mode to camera `index`. Returns true if it delivers
+// undecoded MJPEG buffers (passthrough on and the device agreed to MJPG).
+static bool OpenCamera(cv::VideoCapture& cap, int index) {
+    CaptureFormat fmt = app.CameraFormat(index);
+    if (!cap.open(index)) return false;
+    // FOURCC first: V4L2 only offers the frame sizes of the current pixel format
+    if (fmt.fourcc.size() == 4) cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc(fmt.fourcc[0], fmt.fourcc[1], fmt.fourcc[2], fmt.fourcc[3]));
+    cap.set(cv::CAP_PROP_FRAME_WIDTH, fmt.width);
+    cap.set(cv::CAP_PROP_FRAME_HEIGHT, fmt.height);
+    if (fmt.fps > 0) cap.set(cv::CAP_PROP_FPS, fmt.fps);
+    int fourcc = (int)cap.get(cv::CAP_PROP_FOURCC);
+    char cc[5] = { char(fourcc & 0xFF), char((fourcc >> 8) & 0xFF), char((fourcc >> 16) & 0xFF), char((fourcc >> 24) & 0xFF), 0 };
+    bool raw = std::string(cc) == "MJPG" && app.mjpeg_passthrough && cap.set(cv::CAP_PROP_CONVERT_RGB, 0);
+    char line[160];
+    snprintf(line, sizeof(line), "[SYS] Camera %d opened: %dx%d @ %.0f fps, %s%s", index, (int)cap.get(cv::CAP_PROP_FRAME_WIDTH), (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT),
+             cap.get(cv::CAP_PROP_FPS), fourcc ? cc : "default", raw ? " (passthrough)" : "");
+    app.Log(line);
+    return raw;
+}
+
+static void LocalCaptureThread(SourceWorker& w) {
+    cv::VideoCapture cap;
+    uint64_t format_generation = 0;
+    bool raw_mjpeg = false;
+    JpegCodecSlot codec;
+    cv::Mat grabbed; // undecoded MJPEG buffer, copied out before the next grab
+    cv::Size frame_size;
+    int frame_type = -1;
+    ThreadTuner tuner(ROLE_CAPTURE);
+    while (app.is_running && !w.stop) {
+        tuner.Poll();
+        if (cap.isOpened() && format_generation != app.formats_generation) cap.release();
+        if (!cap.isOpened()) {
+            format_generation = app.formats_generation;
+            raw_mjpeg = OpenCamera(cap, w.source_id);
+            if (!cap.isOpened()) { std::this_thread::sleep_for(std::chrono::milliseconds(500)); continue; }
+        }
+        // grab() blocks until the device delivers a frame, so each worker runs at its camera's own rate.
+        // Decoded frames are retrieved into pooled storage of the last frame's shape.
+        cv::Mat frame = raw_mjpeg ? grabbed : frame_type >= 0 ? w.frames.Acquire(frame_size.height, frame_size.width, frame_type) : cv::Mat();
+        bool ok = cap.grab();
+        int64_t capture_us = WallClockMicros();
+        if (!ok || !cap.retrieve(frame)) { cap.release(); std::this_thread::sleep_for(std::chrono::milliseconds(100)); continue; }
+        if (!raw_mjpeg) { frame_size = frame.size(); frame_type = frame.type(); SubmitFrame(w, frame, capture_us); continue; }
+        grabbed = frame;
+        // Undecoded buffer: one row of bytes. Backends that ignore CONVERT_RGB hand back BGR instead.
+        if (frame.rows != 1 || frame.total() < 4 || frame.data[0] != 0xFF || frame.data[1] != 0xD8) {
+            app.Log("[SYS] Camera " + std::to_string(w.source_id) + " delivers decoded frames; MJPEG passthrough off.");
+            raw_mjpeg = false;
+            cap.set(cv::CAP_PROP_CONVERT_RGB, 1);
+            if (frame.channels() == 3) SubmitFrame(w, frame.clone(), capture_us);
+            continue;
+        }
+        cv::Mat jpeg = PooledBytes(w, frame.data, frame.total()); // the backend may reuse its buffer on the next grab
+        bool forward = CanForwardJpeg();
+        cv::Mat image;
+        if ((!forward || PreviewWanted(w)) && !DecodePooled(w, codec.Get(app.jpeg_backend), jpeg.data, jpeg.total(), image)) continue;
+        if (forward) SubmitFrame(w, image, capture_us, jpeg);
+        else SubmitFrame(w, image, capture_us);
+    }
+}
+
+static void ExternalCaptureThread(SourceWorker& w, zmq::context_t& ctx) {
+    zmq::socket_t subscriber(ctx, zmq::socket_type::sub);
+    zmq::pollitem_t sub_item = { subscriber, 0, ZMQ_POLLIN, 0 };
+    std::string current_zmq_addr = "";
+    JpegCodecSlot codec;
+    ChannelReader reader;
+    const ChannelPolicy& policy = app.delivery[CHANNEL_EXTERNAL];
+    ThreadTuner tuner(ROLE_CAPTURE);
+    while (app.is_running && !w.stop) {
+        tuner.Poll();
+        if (current_zmq_addr != app.external_zmq_addr) {
+            try { subscriber.disconnect(current_zmq_addr); }
+            catch (...) {}
+            current_zmq_addr = app.external_zmq_addr;
+            ApplyRecvPolicy(subscriber, policy);
+            subscriber.connect(current_zmq_addr); subscriber.set(zmq::sockopt::subscribe, "");
+        }
+        zmq::poll(&sub_item, 1, std::chrono::milliseconds(100));
+        if (!(sub_item.revents & ZMQ_POLLIN)) continue;
+        size_t n = reader.Drain(subscriber, policy, app.dropped[CHANNEL_EXTERNAL]);
+        int64_t capture_us = WallClockMicros();
+        for (size_t i = 0; i < n; i++) {
+            zmq::message_t& msg = reader.At(i).back(); // single-part JPEG; a leading topic frame is tolerated
+            // The feed is JPEG already, so it can be forwarded like an MJPEG camera's
+            bool forward = CanForwardJpeg();
+            cv::Mat frame;
+            if ((!forward || PreviewWanted(w)) && !DecodePooled(w, codec.Get(app.jpeg_backend), msg.data(), msg.size(), frame)) continue;
+            if (forward) SubmitFrame(w, frame, capture_us, PooledBytes(w, msg.data(), msg.size()));
+            else SubmitFrame(w, frame, capture_us);
+        }
+    }
+}
+
+// One recorded source's frames, spaced as recorded divided by replay_speed, or
+// back to back at replay_speed = 0. Frames get fresh ids and capture stamps, so
+// the latency figures describe this run.
+static void ReplayCaptureThread(SourceWorker& w) {
+    const RecordingReader& rec = *w.replay;
+    JpegCodecSlot codec;
+    // Schedule: `due_us` advances by the recorded gaps, so sleep overshoot never accumulates
+    int64_t due_us = WallClockMicros(), prev_t = rec.FirstUs();
+    bool any = false;
+    ThreadTuner tuner(ROLE_CAPTURE);
+    while (app.is_running && !w.stop) {
+        for (size_t i = 0; i < rec.Count() && app.is_running && !w.stop; i++) {
+            const RecordIndexEntry& e = rec.Entry(i);
+            if (e.kind != RECORD_FRAME || e.source_id != w.source_id) continue;
+            tuner.Poll();
+            RecordingReader::Record r;
+            if (!rec.Get(i, r)) continue;
+            float speed = app.replay_speed;
+            if (speed > 0.0f) {
+                due_us += (int64_t)((e.t_us - prev_t) / speed);
+                int64_t now = WallClockMicros();
+                // Far behind (stall, speed change): resume from now instead of bursting
+                if (now - due_us > 1000000) due_us = now;
+                while (app.is_running && !w.stop && (now = WallClockMicros()) < due_us)
+                    std::this_thread::sleep_for(std::chrono::microseconds(std::min<int64_t>(due_us - now, 100000)));
+            }
+            prev_t = e.t_us;
+            any = true;
+            const RecordHeader& h = *r.header;
+            int64_t capture_us = WallClockMicros();
+            // The mapping outlives neither this thread nor the UI's copy of the frame, so both get their own buffer
+            if (h.format == RECORD_BGR24) {
+                if (size_t(h.width) * h.height * 3 != h.payload_size) continue;
+                cv::Mat frame = w.frames.Acquire((int)h.height, (int)h.width, CV_8UC3);
+                std::memcpy(frame.data, r.payload, h.payload_size);
+                SubmitFrame(w, frame, capture_us);
+                continue;
+            }
+            if (h.format != RECORD_JPEG) continue;
+            bool forward = CanForwardJpeg();
+            cv::Mat frame;
+            if ((!forward || PreviewWanted(w)) && !DecodePooled(w, codec.Get(app.jpeg_backend), r.payload, h.payload_size, frame)) continue;
+            if (forward) SubmitFrame(w, frame, capture_us, PooledBytes(w, r.payload, h.payload_size));
+            else SubmitFrame(w, frame, capture_us);
+        }
+        if (!app.replay_loop || !any) break;
+        // Next pass continues the schedule as if the recording repeated end to end
+        prev_t -= rec.LastUs() - rec.FirstUs();
+    }
+    if (app.is_running && !w.stop) app.Log("[SYS] Replay of source " + std::to_string(w.source_id) + " finished.");
+}
+
+static void EncodeThread(SourceWorker& w, SourceSet& sources, StageQueue<EncodedFrame>& out) {
+    ShmFrameRing ring;
+    int ring_generation = 0;
+    JpegCodecSlot codec;
+    CapturedFrame f;
+    ThreadTuner tuner(ROLE_ENCODE);
+    while (app.is_running && !w.stop) {
+        tuner.Poll();
+        if (!w.q_encode.Pop(f, std::chrono::milliseconds(100))) continue;
+        // The transport may have switched to shm since this JPEG was queued for forwarding
+        if (!f.jpeg.empty() && app.frame_transport == TRANSPORT_SHM) {
+            if (!codec.Get(app.jpeg_backend).Decode(f.jpeg.data, f.jpeg.total(), f.image)) continue;
+            f.jpeg.release();
+        }
+        int width = f.image.cols, height = f.image.rows;
+        if (!f.jpeg.empty() && !JpegImageSize(f.jpeg.data, f.jpeg.total(), width, height)) { app.dropped[CHANNEL_FRAMES]++; continue; }
+        int slot = -1;
+        cv::Mat e_raw;
+        if (app.frame_transport == TRANSPORT_SHM) {
+            if (!ring.IsOpen()) {
+                // Fresh name per ring so an engine never keeps reading a stale mapping
+                std::string name = "posebridge_" + std::to_string(std::hash<std::string>{}(app.frames_endpoint) & 0xFFFF) + "_" + w.topic + "_" + std::to_string(++ring_generation);
+                if (ring.Create(name, app.shm_slots, kShmMaxFrameBytes)) app.Log("[SYS] Shared memory ring ready: " + name);
+                else { app.Log("[ERR] Shared memory ring failed, falling back to JPEG."); app.frame_transport = TRANSPORT_JPEG; }
+            }
+            slot = ring.Write(f.image, f.seq);
+            if (slot >= 0 && app.recorder.Active()) e_raw = f.image;
+        }
+        else if (ring.IsOpen()) ring.Close();
+        EncodedFrame e;
+        e.raw = std::move(e_raw);
+        e.meta = PayloadPool().Acquire();
+        std::vector<uint8_t>& meta = e.meta->bytes;
+        Append(meta, "{\"frame_id\":"); AppendInt(meta, f.seq); Append(meta, ",\"capture_us\":"); AppendInt(meta, f.capture_us);
+        Append(meta, ",\"cam\":"); AppendInt(meta, w.source_id); Append(meta, ",\"w\":"); AppendInt(meta, width); Append(meta, ",\"h\":"); AppendInt(meta, height);
+        // Grouped frames wait for their "sync" message before the engine runs them
+        if (sources.grouped) Append(meta, ",\"sync\":1");
+        // w / h are the crop's; the engine maps its results back into the full frame
+        if (!f.crop.empty()) {
+            Append(meta, ",\"crop_x\":"); AppendInt(meta, f.crop.x); Append(meta, ",\"crop_y\":"); AppendInt(meta, f.crop.y);
+            Append(meta, ",\"full_w\":"); AppendInt(meta, f.full.width); Append(meta, ",\"full_h\":"); AppendInt(meta, f.full.height);
+        }
+        if (slot >= 0) { Append(meta, ",\"shm\":\""); Append(meta, ring.Name()); Append(meta, "\",\"slot\":"); AppendInt(meta, slot); }
+        else {
+            // Encoded straight into a pooled buffer, which ZMQ later sends without a copy
+            e.payload = PayloadPool().Acquire();
+            if (!f.jpeg.empty()) e.payload->bytes.assign(f.jpeg.data, f.jpeg.data + f.jpeg.total());
+            else codec.Get(app.jpeg_backend).Encode(f.image, 50, e.payload->bytes);
+        }
+        Append(meta, "}");
+        e.topic = w.topic;
+        e.frame_id = f.seq;
+        e.source_id = w.source_id;
+        e.capture_us = f.capture_us;
+        e.encode_us = WallClockMicros();
+        app.latency[STAGE_ENCODE].Record(e.encode_us - f.capture_us);
+        FrameTimeline& tl = app.Timeline(f.seq);
+        if (tl.frame_id == f.seq) tl.encode_us = e.encode_us;
+        if (!out.Push(std::move(e))) app.dropped[CHANNEL_FRAMES]++;
+    }
+}
+
+// Frame messages are [topic, meta, payload]. With several sources, a
+// ["sync", {"group":G,"frames":[{"cam":C,"frame_id":F},...]}, ""] message
+// follows the last frame of each group; PUB keeps per-socket order, so every
+// member has been sent by then.
+static void PublishThread(zmq::context_t& ctx, StageQueue<EncodedFrame>& in, SourceSet& sources) {
+    zmq::socket_t publisher(ctx, zmq::socket_type::pub);
+    ApplySendPolicy(publisher, app.delivery[CHANNEL_FRAMES]);
+    // A remote engine on frames_endpoint, the spawned engine.py on ipc, in-process taps on inproc
+    std::vector<std::string> endpoints = { kInprocFramesEndpoint };
+    if (!app.frames_endpoint.empty()) endpoints.push_back(app.frames_endpoint);
+    if (IpcSupported()) endpoints.push_back(LocalIpcEndpoint("frames"));
+    for (const std::string& endpoint : endpoints) {
+        try { publisher.bind(endpoint); }
+        catch (const zmq::error_t& e) { app.Log("[ERR] Frames " + endpoint + ": " + e.what()); }
+    }
+    FrameSync sync;
+    uint64_t sync_generation = UINT64_MAX, group_id = 0;
+    std::vector<FrameSync::Entry> group;
+    EncodedFrame e;
+    ThreadTuner tuner(ROLE_PUBLISH);
+    while (app.is_running) {
+        tuner.Poll();
+        if (!in.Pop(e, std::chrono::milliseconds(500))) { app.status_cam_pub = false; continue; }
+        {
+            std::lock_guard<std::mutex> lock(sources.mutex);
+            if (sources.generation != sync_generation) { sync.SetSources(sources.ids); sync_generation = sources.generation; }
+        }
+        publisher.send(zmq::buffer(e.topic), zmq::send_flags::sndmore);
+        zmq::message_t msg_meta = PooledMessage(std::move(e.meta)), msg_payload = PooledMessage(std::move(e.payload));
+        // Shared references (no copy) keep the bytes readable for the recorder after the send
+        zmq::message_t rec_meta, rec_payload;
+        bool recording = app.recorder.Active();
+        if (recording) { rec_meta.copy(msg_meta); rec_payload.copy(msg_payload); }
+        publisher.send(msg_meta, zmq::send_flags::sndmore); publisher.send(msg_payload, zmq::send_flags::none);
+        int64_t now = WallClockMicros();
+        app.latency[STAGE_PUBLISH].Record(now - e.encode_us);
+        FrameTimeline& tl = app.Timeline(e.frame_id);
+        if (tl.frame_id == e.frame_id) tl.publish_us = now;
+        app.status_cam_pub = true;
+        if (recording) {
+            std::string_view meta(static_cast<const char*>(rec_meta.data()), rec_meta.size());
+            if (e.raw.empty()) app.recorder.AddFrame(e.source_id, e.frame_id, meta, RECORD_JPEG, rec_payload.data(), rec_payload.size(), 0, 0);
+            else {
+                cv::Mat packed = e.raw.isContinuous() ? e.raw : e.raw.clone();
+                if (packed.type() == CV_8UC3) app.recorder.AddFrame(e.source_id, e.frame_id, meta, RECORD_BGR24, packed.data, packed.total() * 3, packed.cols, packed.rows);
+            }
+        }
+        e.raw.release(); // hands the frame back to its source's pool
+
+        if (sync.SourceCount() > 1 && sync.Add({ e.source_id, e.frame_id, e.capture_us }, app.sync_tolerance_us, group)) {
+            BufferPool::Handle sync_meta = PayloadPool().Acquire();
+            std::vector<uint8_t>& meta = sync_meta->bytes;
+            Append(meta, "{\"group\":"); AppendInt(meta, ++group_id); Append(meta, ",\"frames\":[");
+            for (size_t i = 0; i < group.size(); i++) {
+                Append(meta, i ? ",{\"cam\":" : "{\"cam\":"); AppendInt(meta, group[i].source_id);
+                Append(meta, ",\"frame_id\":"); AppendInt(meta, group[i].frame_id); Append(meta, "}");
+            }
+            Append(meta, "]}");
+            publisher.send(zmq::str_buffer("sync"), zmq::send_flags::sndmore);
+            publisher.send(PooledMessage(std::move(sync_meta)), zmq::send_flags::sndmore);
+            publisher.send(zmq::message_t(), zmq::send_flags::none);
+        }
+    }
+}
+
+static void StopWorker(SourceWorker& w) {
+    w.stop = true;
+    if (w.capture.joinable()) w.capture.join();
+    if (w.encoder.joinable()) w.encoder.join();
+}
+
+// Keeps one worker per wanted source: the selected local cameras, the
+// external feed, or the sources of the recording being replayed. A source's raw_frames slot only ever has one producer, since a
+// worker is joined before another one is started for the same id.
+void CameraThread() {
+    zmq::context_t& ctx = SharedZmqContext();
+    StageQueue<EncodedFrame> q_publish(2 * kMaxSources);
+    SourceSet sources;
+    std::thread sender(PublishThread, std::ref(ctx), std::ref(q_publish), std::ref(sources));
+    std::vector<std::unique_ptr<SourceWorker>> workers;
+    std::shared_ptr<RecordingReader> replay;
+    std::string replay_failed; // not retried until the path changes
+
+    while (app.is_running) {
+        DataSourceMode mode = app.source_mode;
+        bool external = mode == SOURCE_EXTERNAL_ZMQ;
+        if (mode == SOURCE_REPLAY && app.camera_active && (!replay || replay->Path() != app.replay_path) && replay_failed != app.replay_path) {
+            auto rec = std::make_shared<RecordingReader>();
+            if (rec->Open(app.replay_path)) {
+                std::vector<int> ids = rec->FrameSources();
+                app.Log("[SYS] Replaying " + app.replay_path + ": " + std::to_string(rec->Count()) + " records, " + std::to_string(ids.size()) + " source(s)" +
+                        (rec->Recovered() ? " (unfinished file, index rebuilt)" : ""));
+                if (!ids.empty() && std::find(ids.begin(), ids.end(), app.preview_cam.load()) == ids.end()) app.preview_cam = ids.front();
+                app.replay_sources = (int)ids.size();
+                replay = std::move(rec);
+                replay_failed.clear();
+            }
+            else { app.Log("[ERR] Cannot open recording: " + app.replay_path); replay.reset(); replay_failed = app.replay_path; }
+        }
+        if (mode != SOURCE_REPLAY && (replay || !replay_failed.empty())) { replay.reset(); replay_failed.clear(); app.replay_sources = 0; }
+        std::vector<int> wanted;
+        if (app.camera_active) {
+            if (mode == SOURCE_REPLAY) { if (replay) wanted = replay->FrameSources(); }
+            else wanted = external ? std::vector<int>{ 0 } : app.SelectedCams();
+        }
+        bool changed = false;
+        for (auto it = workers.begin(); it != workers.end();) {
+            SourceWorker& w = **it;
+            if (w.mode != mode || w.replay != replay || std::find(wanted.begin(), wanted.end(), w.source_id) == wanted.end()) { StopWorker(w); it = workers.erase(it); changed = true; }
+            else ++it;
+        }
+        for (int id : wanted) {
+            if (std::any_of(workers.begin(), workers.end(), [id](const auto& w) { return w->source_id == id; })) continue;
+            auto w = std::make_unique<SourceWorker>();
+            w->source_id = id; w->mode = mode; w->topic = external ? "ext" : "cam" + std::to_string(id);
+            if (mode == SOURCE_REPLAY) { w->replay = replay; w->capture = std::thread(ReplayCaptureThread, std::ref(*w)); }
+            else if (external) w->capture = std::thread(ExternalCaptureThread, std::ref(*w), std::ref(ctx));
+            else w->capture = std::thread(LocalCaptureThread, std::ref(*w));
+            w->encoder = std::thread(EncodeThread, std::ref(*w), std::ref(sources), std::ref(q_publish));
+            workers.push_back(std::move(w));
+            changed = true;
+        }
+        if (changed) {
+            std::lock_guard<std::mutex> lock(sources.mutex);
+            sources.ids.clear();
+            for (const auto& w : workers) sources.ids.push_back(w->source_id);
+            sources.generation++;
+            sources.grouped = sources.ids.size() > 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    for (auto& w : workers) StopWorker(*w);
+    sender.join();
+}
+
+// Splits a returned pose's journey into the engine-side stages
+static void RecordPoseLatency(const PoseHeader& h, int64_t recv_us) {
+    FrameTimeline& tl = app.Timeline(h.frame_id);
+    int64_t publish_us = tl.publish_us;
+    if (h.engine_recv_us && publish_us && tl.frame_id == h.frame_id) app.latency[STAGE_ENGINE_RECV].Record(h.engine_recv_us - publish_us);
+    if (h.engine_recv_us && h.inference_us) app.latency[STAGE_INFERENCE].Record(h.inference_us - h.engine_recv_us);
+    if (h.inference_us) app.latency[STAGE_POSE_RECV].Record(recv_us - h.inference_us);
+    if (h.capture_us) app.latency[STAGE_END_TO_END].Record(recv_us - h.capture_us);
+}
+
+// Full-frame image keypoints for the UI's skeleton overlay; poses may be world space
+static void PublishImagePose(const PoseHeader& h, const float* keypoints, size_t count, uint64_t seq) {
+    TripleBuffer<PoseSlot>& poses = app.image_poses[h.source_id < kMaxSources ? h.source_id : 0];
+    PoseSlot& slot = poses.WriteBuffer();
+    slot.header = h; slot.keypoints.assign(keypoints, keypoints + count);
+    slot.recv_us = WallClockMicros(); slot.seq = seq; poses.Publish();
+    if (h.source_id == app.PreviewSource() && !app.EnginePreviewWanted()) app.WakeUi();
+}
+
+static void PublishPose(const PoseHeader& h, const float* keypoints, size_t count, uint64_t& pose_seq) {
+    TripleBuffer<PoseSlot>& poses = app.poses[h.source_id < kMaxSources ? h.source_id : 0];
+    PoseSlot& slot = poses.WriteBuffer();
+    slot.header = h; slot.keypoints.assign(keypoints, keypoints + count);
+    slot.recv_us = WallClockMicros(); slot.seq = ++pose_seq; poses.Publish();
+    RecordPoseLatency(h, slot.recv_us);
+    if (app.pose_filters.enabled) app.pose_filters.Update(h, keypoints, count);
+    app.outputs.Publish(h, keypoints, count, slot.recv_us);
+    app.recorder.AddPose(h, keypoints, count);
+    app.count_pose_packets++;
+    app.status_pose_sub = true;
+}
+
+// The native engine's results arrive here too, so poses and preview_frames keep a single producer
+static void ReceiveNativeResults(uint64_t& preview_seq, uint64_t& pose_seq) {
+    EngineResult r;
+    if (!app.engine_results.Pop(r, std::chrono::milliseconds(10))) { app.status_pose_sub = false; app.status_prev_sub = false; return; }
+    if (!r.preview.empty()) {
+        FrameSlot& slot = app.preview_frames.WriteBuffer();
+        slot.image = r.preview; slot.seq = ++preview_seq; slot.capture_us = r.header.capture_us;
+        app.preview_frames.Publish();
+        app.WakeUi();
+        app.count_preview_frames++;
+    }
+    app.status_prev_sub = !r.preview.empty();
+    if (r.header.source_id < kMaxSources) app.roi_trackers[r.header.source_id].Observe(r.person_box);
+    PublishPose(r.header, r.keypoints.data(), r.keypoints.size(), pose_seq);
+    PublishImagePose(r.header, r.keypoints.data(), r.keypoints.size(), pose_seq);
+}
+
+// Stream keys for the engine channels: previews carry "cam" in their meta, poses the header's source_id
+static uint64_t PreviewStream(const std::vector<zmq::message_t>& parts) {
+    if (parts.empty()) return 0;
+    return (uint64_t)JsonInt(std::string_view(static_cast<const char*>(parts[0].data()), parts[0].size()), "cam", 0);
+}
+
+static uint64_t PoseStream(const std::vector<zmq::message_t>& parts) {
+    PoseView view;
+    return parts.size() >= 2 && ParsePosePacket(parts[1].data(), parts[1].size(), view) ? view.header.source_id : 0;
+}
+
+static void HandlePreview(std::vector<zmq::message_t>& msgs, JpegCodec& codec, uint64_t& preview_seq) {
+    // Stragglers sent before the engine heard the preview was turned off
+    if (msgs.size() < 2 || !app.EnginePreviewWanted()) return;
+    std::string_view meta(static_cast<const char*>(msgs[0].data()), msgs[0].size());
+    int64_t cam = JsonInt(meta, "cam", -1);
+    // Only the shown source is decoded; previews of the other views are skipped
+    if (cam >= 0 && cam != app.PreviewSource()) return;
+    // Decode straight into the back buffer; its storage is reused once the size settles
+    FrameSlot& slot = app.preview_frames.WriteBuffer();
+    if (!codec.Decode(msgs[1].data(), msgs[1].size(), slot.image)) return;
+    slot.seq = ++preview_seq;
+    slot.capture_us = JsonInt(meta, "capture_us");
+    app.preview_frames.Publish();
+    app.WakeUi();
+    app.count_preview_frames++;
+}
+
+// Whichever engine binds first is heard: a TCP one on `endpoint`, or the spawned engine.py over ipc
+static void ConnectEngineChannel(zmq::socket_t& sub, const std::string& endpoint, const char* channel) {
+    if (!endpoint.empty()) sub.connect(endpoint);
+    if (IpcSupported()) sub.connect(LocalIpcEndpoint(channel));
+    sub.set(zmq::sockopt::subscribe, "");
+}
+
+void ReceiverThread() {
+    zmq::context_t& ctx = SharedZmqContext();
+    // engine.py failover rebinds the ports from a new process; reconnect to it without the default 100 ms backoff
+    zmq::socket_t sub_img(ctx, zmq::socket_type::sub); ApplyRecvPolicy(sub_img, app.delivery[CHANNEL_PREVIEW]);
+    sub_img.set(zmq::sockopt::reconnect_ivl, 10);
+    ConnectEngineChannel(sub_img, app.preview_endpoint, "preview");
+    zmq::socket_t sub_pose(ctx, zmq::socket_type::sub); ApplyRecvPolicy(sub_pose, app.delivery[CHANNEL_POSE]);
+    sub_pose.set(zmq::sockopt::reconnect_ivl, 10);
+    ConnectEngineChannel(sub_pose, app.pose_endpoint, "pose");
+    zmq::pollitem_t items[] = { { sub_img, 0, ZMQ_POLLIN, 0 }, { sub_pose, 0, ZMQ_POLLIN, 0 } };
+    ChannelReader preview_reader, pose_reader;
+    uint64_t preview_seq = 0, pose_seq = 0;
+    JpegCodecSlot codec;
+    bool bad_pose_logged = false;
+    ThreadTuner tuner(ROLE_RECEIVER);
+    while (app.is_running) {
+        tuner.Poll();
+        if (app.engine_kind == ENGINE_NATIVE) { ReceiveNativeResults(preview_seq, pose_seq); continue; }
+        zmq::poll(items, 2, std::chrono::milliseconds(10));
+        if (items[0].revents & ZMQ_POLLIN) {
+            size_t n = preview_reader.Drain(sub_img, app.delivery[CHANNEL_PREVIEW], app.dropped[CHANNEL_PREVIEW], PreviewStream);
+            for (size_t i = 0; i < n; i++) HandlePreview(preview_reader.At(i), codec.Get(app.jpeg_backend), preview_seq);
+            app.status_prev_sub = n > 0;
+        }
+        else app.status_prev_sub = false;
+        if (items[1].revents & ZMQ_POLLIN) {
+            size_t n = pose_reader.Drain(sub_pose, app.delivery[CHANNEL_POSE], app.dropped[CHANNEL_POSE], PoseStream);
+            for (size_t i = 0; i < n; i++) {
+                std::vector<zmq::message_t>& msgs = pose_reader.At(i);
+                if (msgs.size() < 2) continue;
+                // engine.py reports its own shedding and the person box in the summary frame
+                std::string_view meta(static_cast<const char*>(msgs[0].data()), msgs[0].size());
+                app.engine_dropped = (uint64_t)JsonInt(meta, "dropped", (int64_t)app.engine_dropped.load());
+                PoseView view;
+                if (ParsePosePacket(msgs[1].data(), msgs[1].size(), view)) {
+                    cv::Rect box((int)JsonInt(meta, "roi_x"), (int)JsonInt(meta, "roi_y"), (int)JsonInt(meta, "roi_w"), (int)JsonInt(meta, "roi_h"));
+                    if (view.header.source_id < kMaxSources) app.roi_trackers[view.header.source_id].Observe(box);
+                    PublishPose(view.header, view.keypoints, view.FloatCount(), pose_seq);
+                    // Third frame: the same pose in image space (engine.py with output control)
+                    PoseView image;
+                    if (msgs.size() > 2 && ParsePosePacket(msgs[2].data(), msgs[2].size(), image) && image.header.layout == POSE_LAYOUT_IMAGE_XYZV)
+                        PublishImagePose(image.header, image.keypoints, image.FloatCount(), pose_seq);
+                }
+                else if (!bad_pose_logged) { app.Log("[ERR] Unrecognized pose packet (engine.py out of date?)"); bad_pose_logged = true; }
+            }
+        }
+        else app.status_pose_sub = false;
+    }
+}
+
+std::string StatusJson() {
+    auto flag = [](bool b) { return b ? "true" : "false"; };
+    std::string out = "{";
+    out += "\"camera_active\":" + std::string(flag(app.camera_active)) + ",\"backend_running\":" + flag(app.backend_running);
+    out += ",\"standby_ready\":" + std::string(flag(app.standby_ready)) + ",\"engine_failovers\":" + std::to_string(app.engine_failovers);
+    out += ",\"recording\":" + std::string(flag(app.recorder.Active())) + ",\"recorded\":" + std::to_string(app.recorder.Records());
+    out += ",\"cam_pub\":" + std::string(flag(app.status_cam_pub)) + ",\"prev_sub\":" + flag(app.status_prev_sub) + ",\"pose_sub\":" + flag(app.status_pose_sub);
+    std::vector<int> cams = app.SelectedCams();
+    out += ",\"cams\":[";
+    for (size_t i = 0; i < cams.size(); i++) out += (i ? "," : "") + std::to_string(cams[i]);
+    out += "]";
+    out += ",\"engine\":\"" + std::string(app.engine_kind == ENGINE_NATIVE ? "native" : "python") + "\"";
+    out += ",\"jpeg\":\"" + std::string(kJpegBackendNames[app.jpeg_backend]) + "\"";
+    out += ",\"frames\":" + std::to_string(app.count_cam_frames) + ",\"previews\":" + std::to_string(app.count_preview_frames) + ",\"poses\":" + std::to_string(app.count_pose_packets);
+    out += ",\"passthrough_frames\":" + std::to_string(app.count_passthrough_frames);
+    out += ",\"cropped_frames\":" + std::to_string(app.count_cropped_frames) + ",\"shipped_pixels\":" + std::to_string(app.count_shipped_pixels);
+    out += ",\"batches\":" + std::to_string(app.count_batches) + ",\"batched_frames\":" + std::to_string(app.count_batched_frames);
+    out += ",\"engine_superseded\":" + std::to_string(app.engine_frames.Superseded()) + ",\"engine_stale\":" + std::to_string(app.engine_frames.Stale());
+    out += ",\"dropped\":{";
+    for (int c = 0; c < CHANNEL_COUNT; c++) out += std::string(c ? "," : "") + "\"" + kChannelNames[c] + "\":" + std::to_string(app.dropped[c]);
+    out += ",\"engine\":" + std::to_string(app.engine_dropped) + "}";
+    out += ",\"pose_filter\":" + std::string(flag(app.pose_filters.enabled));
+    out += ",\"outputs\":{";
+    for (int k = 0; k < SINK_COUNT; k++) {
+        PoseSinkKind kind = PoseSinkKind(k);
+        out += std::string(k ? "," : "") + "\"" + kPoseSinkNames[k] + "\":{\"active\":" + flag(app.outputs.Active(kind));
+        out += ",\"sent\":" + std::to_string(app.outputs.Sent(kind)) + ",\"dropped\":" + std::to_string(app.outputs.Dropped(kind)) + ",\"errors\":" + std::to_string(app.outputs.Errors(kind)) + "}";
+    }
+    out += "}";
+    out += ",\"latency_us\":{";
+    LatencyHistogram::Snapshot snap;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        app.latency[i].Read(snap);
+        if (i) out += ",";
+        out += "\"" + std::string(kStageNames[i]) + "\":[" + std::to_string(snap.Percentile(0.50)) + "," + std::to_string(snap.Percentile(0.95)) + "," + std::to_string(snap.Percentile(0.99)) + "]";
+    }
+    out += "}}";
+    return out;
+}
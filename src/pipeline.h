@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Capture/receive pipeline, shared by the GUI and the headless executable.
+void CameraThread();
+void ReceiverThread();
+
+// Integer field lookup in the flat JSON metadata frames exchanged with engine.py
+int64_t JsonInt(std::string_view json, std::string_view key, int64_t fallback = 0);
+// One-line JSON summary of connection state, rates and cumulative latency percentiles
+std::string StatusJson();
@@ -0,0 +1,183 @@
+#include "pose_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Positions and visibility of a keypoint as sent; components beyond the fourth are dropped
+static int PositionCount(int components) { return components < 3 ? components : 3; }
+
+static int32_t QuantizePosition(float v, int shift) {
+    if (!std::isfinite(v)) return 0;
+    return (int32_t)std::clamp<long>(std::lround(v * float(1 << shift)), INT16_MIN, INT16_MAX);
+}
+
+static int32_t QuantizeVisibility(float v) {
+    if (!std::isfinite(v)) return 0;
+    return (int32_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+}
+
+static void PutVarint(std::vector<uint8_t>& out, int32_t d) {
+    uint32_t z = (uint32_t(d) << 1) ^ uint32_t(d >> 31);
+    while (z >= 0x80) { out.push_back(uint8_t(z | 0x80)); z >>= 7; }
+    out.push_back(uint8_t(z));
+}
+
+static bool GetVarint(const uint8_t*& p, const uint8_t* end, int32_t& d) {
+    uint32_t z = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) return false;
+        uint8_t b = *p++;
+        z |= uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) { d = int32_t(z >> 1) ^ -int32_t(z & 1); return true; }
+    }
+    return false;
+}
+
+bool PoseEncoder::Encode(const PoseHeader& header, const float* keypoints, size_t count, std::vector<uint8_t>& out) {
+    if (header.person_count > 255 || header.keypoint_count > 255 || header.components == 0) return false;
+    const int in_c = header.components;
+    if (count < size_t(header.person_count) * header.keypoint_count * in_c) return false;
+    const int positions = PositionCount(in_c);
+    const bool has_v = in_c >= 4;
+    const int c = positions + (has_v ? 1 : 0);
+    const size_t points = size_t(header.person_count) * header.keypoint_count;
+    const uint8_t shift = header.layout == POSE_LAYOUT_IMAGE_XYZV ? kCompactImageShift : kCompactWorldShift;
+
+    quantized_.resize(points * c);
+    for (size_t i = 0; i < points; i++) {
+        const float* src = keypoints + i * in_c;
+        int32_t* q = quantized_.data() + i * c;
+        for (int k = 0; k < positions; k++) q[k] = QuantizePosition(src[k], shift);
+        if (has_v) q[positions] = QuantizeVisibility(src[3]);
+    }
+
+    if (header.source_id >= states_.size()) states_.resize(size_t(header.source_id) + 1);
+    State& s = states_[header.source_id];
+    bool keyframe = !s.valid || s.since_keyframe + 1 >= keyframe_interval_ || s.persons != header.person_count ||
+        s.keypoints != header.keypoint_count || s.components != c || s.layout != header.layout;
+
+    CompactPoseHeader h{};
+    h.magic = kCompactPoseMagic;
+    h.version = kCompactPoseVersion;
+    h.flags = keyframe ? kCompactKeyframe : 0;
+    h.source_id = header.source_id;
+    h.sequence = s.sequence = uint16_t(s.sequence + 1);
+    h.person_count = uint8_t(header.person_count);
+    h.keypoint_count = uint8_t(header.keypoint_count);
+    h.components = uint8_t(c);
+    h.layout = header.layout;
+    h.position_shift = shift;
+    h.frame_id = uint32_t(header.frame_id);
+    h.latency_us = uint32_t(std::clamp<int64_t>(header.inference_us - header.capture_us, 0, UINT32_MAX));
+    h.capture_us = header.capture_us;
+    out.resize(sizeof(h));
+    std::memcpy(out.data(), &h, sizeof(h));
+
+    if (keyframe) {
+        for (size_t i = 0; i < points; i++) {
+            const int32_t* q = quantized_.data() + i * c;
+            for (int k = 0; k < positions; k++) { int16_t v = int16_t(q[k]); out.insert(out.end(), reinterpret_cast<uint8_t*>(&v), reinterpret_cast<uint8_t*>(&v) + 2); }
+            if (has_v) out.push_back(uint8_t(q[positions]));
+        }
+        s.ref = quantized_;
+        s.valid = true;
+        s.since_keyframe = 0;
+        s.persons = h.person_count;
+        s.keypoints = h.keypoint_count;
+        s.components = h.components;
+        s.layout = h.layout;
+        return true;
+    }
+
+    const size_t mask_bytes = (size_t(header.keypoint_count) + 7) / 8;
+    for (int person = 0; person < header.person_count; person++) {
+        size_t mask_at = out.size();
+        out.resize(out.size() + mask_bytes, 0);
+        for (int kp = 0; kp < header.keypoint_count; kp++) {
+            size_t i = (size_t(person) * header.keypoint_count + kp) * c;
+            int32_t moved = 0;
+            for (int k = 0; k < c; k++) moved = std::max(moved, std::abs(quantized_[i + k] - s.ref[i + k]));
+            if (moved <= deadband_) continue;
+            out[mask_at + kp / 8] |= uint8_t(1 << (kp % 8));
+            for (int k = 0; k < c; k++) { PutVarint(out, quantized_[i + k] - s.ref[i + k]); s.ref[i + k] = quantized_[i + k]; }
+        }
+    }
+    s.since_keyframe++;
+    return true;
+}
+
+PoseDecoder::Result PoseDecoder::Decode(const void* data, size_t size, PoseHeader& header, std::vector<float>& keypoints) {
+    CompactPoseHeader h;
+    if (size < sizeof(h)) return POSE_INVALID;
+    std::memcpy(&h, data, sizeof(h));
+    if (h.magic != kCompactPoseMagic || h.version != kCompactPoseVersion || h.components == 0 || h.components > 4 || h.position_shift > 15) return POSE_INVALID;
+    const int c = h.components;
+    const int positions = PositionCount(c);
+    const bool has_v = c >= 4;
+    const size_t points = size_t(h.person_count) * h.keypoint_count;
+    const uint8_t* p = static_cast<const uint8_t*>(data) + sizeof(h);
+    const uint8_t* end = static_cast<const uint8_t*>(data) + size;
+
+    if (h.source_id >= states_.size()) states_.resize(size_t(h.source_id) + 1);
+    State& s = states_[h.source_id];
+    if (h.flags & kCompactKeyframe) {
+        if (size_t(end - p) != points * (positions * 2 + (has_v ? 1 : 0))) { s.valid = false; return POSE_INVALID; }
+        s.ref.resize(points * c);
+        for (size_t i = 0; i < points; i++) {
+            int32_t* q = s.ref.data() + i * c;
+            for (int k = 0; k < positions; k++) { int16_t v; std::memcpy(&v, p, 2); p += 2; q[k] = v; }
+            if (has_v) q[positions] = *p++;
+        }
+        s.valid = true;
+        s.persons = h.person_count;
+        s.keypoints = h.keypoint_count;
+        s.components = h.components;
+        s.layout = h.layout;
+        s.shift = h.position_shift;
+    }
+    else {
+        bool follows = s.valid && h.sequence == uint16_t(s.sequence + 1) && s.persons == h.person_count && s.keypoints == h.keypoint_count &&
+            s.components == h.components && s.layout == h.layout && s.shift == h.position_shift;
+        if (!follows) { s.valid = false; return POSE_NEEDS_KEYFRAME; }
+        const size_t mask_bytes = (size_t(h.keypoint_count) + 7) / 8;
+        for (int person = 0; person < h.person_count; person++) {
+            if (size_t(end - p) < mask_bytes) { s.valid = false; return POSE_INVALID; }
+            const uint8_t* mask = p;
+            p += mask_bytes;
+            for (int kp = 0; kp < h.keypoint_count; kp++) {
+                if (!(mask[kp / 8] & (1 << (kp % 8)))) continue;
+                int32_t* q = s.ref.data() + (size_t(person) * h.keypoint_count + kp) * c;
+                for (int k = 0; k < c; k++) {
+                    int32_t d;
+                    if (!GetVarint(p, end, d)) { s.valid = false; return POSE_INVALID; }
+                    q[k] += d;
+                }
+            }
+        }
+        if (p != end) { s.valid = false; return POSE_INVALID; }
+    }
+    s.sequence = h.sequence;
+
+    header = PoseHeader{};
+    header.magic = kPoseMagic;
+    header.version = kPoseVersion;
+    header.header_size = sizeof(PoseHeader);
+    header.frame_id = h.frame_id;
+    header.capture_us = h.capture_us;
+    header.inference_us = h.capture_us + h.latency_us;
+    header.person_count = h.person_count;
+    header.keypoint_count = h.keypoint_count;
+    header.components = h.components;
+    header.layout = h.layout;
+    header.source_id = h.source_id;
+    keypoints.resize(points * c);
+    const float step = 1.0f / float(1 << h.position_shift);
+    for (size_t i = 0; i < points; i++) {
+        const int32_t* q = s.ref.data() + i * c;
+        float* out = keypoints.data() + i * c;
+        for (int k = 0; k < positions; k++) out[k] = float(q[k]) * step;
+        if (has_v) out[positions] = float(q[positions]) / 255.0f;
+    }
+    return POSE_DECODED;
+}
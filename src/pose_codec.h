@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pose_format.h"
+
+// Compact pose packets for low-bandwidth consumers (the "compact" UDP sink).
+// Little-endian, one datagram per pose:
+//   CompactPoseHeader
+//   keyframe: per person, per keypoint: int16 position[P], uint8 visibility (if V)
+//   delta:    per person: changed-keypoint bitmask (ceil(K / 8) bytes, LSB first),
+//             then per set bit: zigzag varint delta of each position[P], then of visibility (if V)
+// P = min(components, 3), V = components >= 4; further components are dropped.
+// Positions are fixed point, value * 2^position_shift. Visibility is 0..1 in
+// 1/255 steps. A delta is relative to the previous packet of the same source
+// (sequence - 1); keypoints that moved no more than the deadband are left out
+// and keep their previous value. A receiver that lost a packet waits for the
+// next keyframe. scripts/pose_compact.py is a standalone decoder.
+
+constexpr uint32_t kCompactPoseMagic = 0x43504250; // "PBPC"
+constexpr uint8_t kCompactPoseVersion = 1;
+constexpr uint8_t kCompactKeyframe = 1; // flags
+
+// Step 1/4096 for normalized image coordinates, 1/2048 m for world ones
+constexpr uint8_t kCompactImageShift = 12;
+constexpr uint8_t kCompactWorldShift = 11;
+
+struct CompactPoseHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t source_id;
+    uint16_t sequence;       // per source, wraps
+    uint8_t person_count;
+    uint8_t keypoint_count;
+    uint8_t components;      // of the decoded pose, min(source components, 4)
+    uint8_t layout;          // PoseLayout
+    uint8_t position_shift;
+    uint8_t reserved;
+    uint32_t frame_id;       // low 32 bits
+    uint32_t latency_us;     // inference_us - capture_us, saturated
+    int64_t capture_us;
+};
+static_assert(sizeof(CompactPoseHeader) == 32, "CompactPoseHeader layout is shared with pose_compact.py");
+
+class PoseEncoder {
+public:
+    // A keyframe goes out at least every `keyframe_interval` packets per source
+    // (1 = keyframes only); `deadband` is in quantization steps.
+    void SetParams(int keyframe_interval, int deadband) { keyframe_interval_ = keyframe_interval < 1 ? 1 : keyframe_interval; deadband_ = deadband < 0 ? 0 : deadband; }
+
+    // Replaces `out` with the packet. False if the pose does not fit the format
+    // (more than 255 people or keypoints, fewer keypoints than the header says).
+    bool Encode(const PoseHeader& header, const float* keypoints, size_t count, std::vector<uint8_t>& out);
+
+private:
+    struct State {
+        bool valid = false;
+        uint16_t sequence = 0;
+        int since_keyframe = 0;
+        uint8_t persons = 0, keypoints = 0, components = 0, layout = 0;
+        std::vector<int32_t> ref; // what the receiver holds, person-major, components per keypoint
+    };
+
+    int keyframe_interval_ = 30;
+    int deadband_ = 2;
+    std::vector<State> states_; // by source id
+    std::vector<int32_t> quantized_;
+};
+
+// Reference decoder, also used by posebridge_bench to check the round trip
+class PoseDecoder {
+public:
+    enum Result {
+        POSE_DECODED = 0,
+        POSE_NEEDS_KEYFRAME, // a delta without its predecessor; dropped until the next keyframe
+        POSE_INVALID
+    };
+
+    // On POSE_DECODED, `header` is a current-version PoseHeader (engine_recv_us 0)
+    // and `keypoints` holds person_count * keypoint_count * components floats.
+    Result Decode(const void* data, size_t size, PoseHeader& header, std::vector<float>& keypoints);
+
+private:
+    struct State {
+        bool valid = false;
+        uint16_t sequence = 0;
+        uint8_t persons = 0, keypoints = 0, components = 0, layout = 0, shift = 0;
+        std::vector<int32_t> ref;
+    };
+
+    std::vector<State> states_;
+};
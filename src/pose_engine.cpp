@@ -0,0 +1,476 @@
+#include "pose_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+#ifdef POSEBRIDGE_HAS_OPENCV_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudaarithm.hpp>
+#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#endif
+
+#ifdef POSEBRIDGE_HAS_ONNXRUNTIME
+#include <onnxruntime_cxx_api.h>
+#if defined(_WIN32) && defined(POSEBRIDGE_HAS_ORT_DML)
+#include <dml_provider_factory.h>
+#endif
+#endif
+#ifdef POSEBRIDGE_HAS_TENSORRT
+#include <NvInferRuntime.h>
+#include <cuda_runtime_api.h>
+#endif
+
+#include "app_state.h"
+#include "clock.h"
+
+const char* kModelFormatNames[2] = { "simcc", "blazepose" };
+const char* kProviderNames[PROVIDER_COUNT] = { "cpu", "cuda", "directml", "tensorrt" };
+const char* kPreprocessNames[PREPROCESS_DEVICE_COUNT] = { "cpu", "opencl", "cuda" };
+
+// --- 1. ONNX Runtime ---
+#ifdef POSEBRIDGE_HAS_ONNXRUNTIME
+class OrtBackend : public InferenceBackend {
+public:
+    bool Load(const NativeEngineConfig& config, std::string& error) {
+        try {
+            Ort::SessionOptions so;
+            so.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+            if (config.threads > 0) so.SetIntraOpNumThreads(config.threads);
+            if (config.provider == PROVIDER_ORT_CUDA) {
+                OrtCUDAProviderOptions cuda{};
+                so.AppendExecutionProvider_CUDA(cuda);
+                name_ = "onnxruntime-cuda";
+            }
+            else if (config.provider == PROVIDER_ORT_DIRECTML) {
+#if defined(_WIN32) && defined(POSEBRIDGE_HAS_ORT_DML)
+                // DirectML does not support memory patterns or parallel execution
+                so.DisableMemPattern();
+                so.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+                Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_DML(so, 0));
+                name_ = "onnxruntime-directml";
+#else
+                error = "DirectML provider not built in";
+                return false;
+#endif
+            }
+            session_ = std::make_unique<Ort::Session>(env_, std::filesystem::path(config.model_path).c_str(), so);
+            Ort::AllocatorWithDefaultOptions alloc;
+            input_name_ = session_->GetInputNameAllocated(0, alloc).get();
+            input_shape_ = session_->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+            if (input_shape_.size() != 4) { error = "expected a 4-D image input"; return false; }
+            // The batch dimension may be dynamic; spatial dimensions must be fixed
+            for (size_t d = 1; d < input_shape_.size(); d++) if (input_shape_[d] <= 0) { error = "model input size must be fixed"; return false; }
+            for (size_t i = 0; i < session_->GetOutputCount(); i++) output_names_.push_back(session_->GetOutputNameAllocated(i, alloc).get());
+        }
+        catch (const Ort::Exception& e) { error = e.what(); return false; }
+        for (const auto& n : output_names_) output_name_ptrs_.push_back(n.c_str());
+        return true;
+    }
+
+    const char* Name() const override { return name_; }
+    const std::vector<int64_t>& InputShape() const override { return input_shape_; }
+
+    bool Run(const std::vector<float>& input, int batch, std::vector<Tensor>& outputs) override {
+        try {
+            std::vector<int64_t> shape = input_shape_;
+            shape[0] = batch;
+            Ort::Value in = Ort::Value::CreateTensor<float>(mem_, const_cast<float*>(input.data()), input.size(), shape.data(), shape.size());
+            const char* in_name = input_name_.c_str();
+            std::vector<Ort::Value> values = session_->Run(Ort::RunOptions{ nullptr }, &in_name, &in, 1, output_name_ptrs_.data(), output_name_ptrs_.size());
+            outputs.resize(values.size());
+            for (size_t i = 0; i < values.size(); i++) {
+                Ort::TensorTypeAndShapeInfo info = values[i].GetTensorTypeAndShapeInfo();
+                outputs[i].shape = info.GetShape();
+                const float* p = values[i].GetTensorData<float>();
+                outputs[i].data.assign(p, p + info.GetElementCount());
+            }
+            return true;
+        }
+        catch (const Ort::Exception& e) { app.Log(std::string("[ERR] onnxruntime: ") + e.what()); return false; }
+    }
+
+private:
+    Ort::Env env_{ ORT_LOGGING_LEVEL_WARNING, "posebridge" };
+    Ort::MemoryInfo mem_ = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::unique_ptr<Ort::Session> session_;
+    const char* name_ = "onnxruntime-cpu";
+    std::string input_name_;
+    std::vector<int64_t> input_shape_;
+    std::vector<std::string> output_names_;
+    std::vector<const char*> output_name_ptrs_;
+};
+#endif
+
+// --- 2. TensorRT ---
+#ifdef POSEBRIDGE_HAS_TENSORRT
+class TrtLogger : public nvinfer1::ILogger {
+    void log(Severity severity, const char* msg) noexcept override {
+        if (severity <= Severity::kWARNING) app.Log(std::string("[TRT] ") + msg);
+    }
+};
+
+class TensorRtBackend : public InferenceBackend {
+public:
+    ~TensorRtBackend() override {
+        for (Binding& b : bindings_) if (b.device) cudaFree(b.device);
+        delete context_;
+        delete engine_;
+        delete runtime_;
+        if (stream_) cudaStreamDestroy(stream_);
+    }
+
+    bool Load(const NativeEngineConfig& config, std::string& error) {
+        std::ifstream in(config.model_path, std::ios::binary);
+        if (!in) { error = "cannot read " + config.model_path; return false; }
+        std::vector<char> plan((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        runtime_ = nvinfer1::createInferRuntime(logger_);
+        if (runtime_) engine_ = runtime_->deserializeCudaEngine(plan.data(), plan.size());
+        if (engine_) context_ = engine_->createExecutionContext();
+        if (!context_) { error = "failed to deserialize TensorRT engine"; return false; }
+        if (cudaStreamCreate(&stream_) != cudaSuccess) { error = "cudaStreamCreate failed"; return false; }
+        for (int i = 0; i < engine_->getNbIOTensors(); i++) {
+            const char* name = engine_->getIOTensorName(i);
+            if (engine_->getTensorDataType(name) != nvinfer1::DataType::kFLOAT) { error = std::string("tensor ") + name + " is not float32"; return false; }
+            nvinfer1::Dims dims = engine_->getTensorShape(name);
+            Binding b;
+            b.input = engine_->getTensorIOMode(name) == nvinfer1::TensorIOMode::kINPUT;
+            size_t count = 1;
+            for (int d = 0; d < dims.nbDims; d++) {
+                if (dims.d[d] < 0) { error = "dynamic shapes are not supported, build the engine with fixed dimensions"; return false; }
+                b.shape.push_back(dims.d[d]);
+                count *= size_t(dims.d[d]);
+            }
+            b.count = count;
+            if (cudaMalloc(&b.device, count * sizeof(float)) != cudaSuccess) { error = "cudaMalloc failed"; return false; }
+            context_->setTensorAddress(name, b.device);
+            bindings_.push_back(std::move(b));
+        }
+        auto in_it = std::find_if(bindings_.begin(), bindings_.end(), [](const Binding& b) { return b.input; });
+        if (in_it == bindings_.end()) { error = "engine has no input"; return false; }
+        input_ = size_t(in_it - bindings_.begin());
+        return true;
+    }
+
+    const char* Name() const override { return "tensorrt"; }
+    const std::vector<int64_t>& InputShape() const override { return bindings_[input_].shape; }
+
+    // Shapes are fixed at build time, so `batch` always equals the engine's
+    bool Run(const std::vector<float>& input, int batch, std::vector<Tensor>& outputs) override {
+        const Binding& in = bindings_[input_];
+        if (input.size() != in.count || batch != in.shape[0]) return false;
+        cudaMemcpyAsync(in.device, input.data(), in.count * sizeof(float), cudaMemcpyHostToDevice, stream_);
+        if (!context_->enqueueV3(stream_)) return false;
+        outputs.resize(bindings_.size() - 1);
+        size_t o = 0;
+        for (const Binding& b : bindings_) {
+            if (b.input) continue;
+            outputs[o].shape = b.shape;
+            outputs[o].data.resize(b.count);
+            cudaMemcpyAsync(outputs[o].data.data(), b.device, b.count * sizeof(float), cudaMemcpyDeviceToHost, stream_);
+            o++;
+        }
+        return cudaStreamSynchronize(stream_) == cudaSuccess;
+    }
+
+private:
+    struct Binding {
+        bool input = false;
+        std::vector<int64_t> shape;
+        size_t count = 0;
+        void* device = nullptr;
+    };
+
+    TrtLogger logger_;
+    nvinfer1::IRuntime* runtime_ = nullptr;
+    nvinfer1::ICudaEngine* engine_ = nullptr;
+    nvinfer1::IExecutionContext* context_ = nullptr;
+    cudaStream_t stream_ = nullptr;
+    std::vector<Binding> bindings_; // engine I/O order
+    size_t input_ = 0;
+};
+#endif
+
+bool ProviderAvailable(InferenceProvider provider) {
+    switch (provider) {
+#ifdef POSEBRIDGE_HAS_ONNXRUNTIME
+    case PROVIDER_ORT_CPU:
+    case PROVIDER_ORT_CUDA: return true;
+#if defined(_WIN32) && defined(POSEBRIDGE_HAS_ORT_DML)
+    case PROVIDER_ORT_DIRECTML: return true;
+#endif
+#endif
+#ifdef POSEBRIDGE_HAS_TENSORRT
+    case PROVIDER_TENSORRT: return true;
+#endif
+    default: return false;
+    }
+}
+
+bool PreprocessAvailable(PreprocessDevice device) {
+    switch (device) {
+    case PREPROCESS_CPU: return true;
+    case PREPROCESS_OPENCL: return cv::ocl::haveOpenCL();
+#ifdef POSEBRIDGE_HAS_OPENCV_CUDA
+    case PREPROCESS_CUDA: return cv::cuda::getCudaEnabledDeviceCount() > 0;
+#endif
+    default: return false;
+    }
+}
+
+// --- 3. Pre/Post Processing ---
+// The input tensor is host memory for both runtimes here, so the GPU paths end
+// with one download of the finished float planes instead of the CPU passes.
+struct PoseEngine::DeviceBuffers {
+    cv::UMat padded, rgb, normalized;
+    std::vector<cv::UMat> planes;
+#ifdef POSEBRIDGE_HAS_OPENCV_CUDA
+    cv::cuda::GpuMat g_src, g_padded, g_rgb, g_normalized;
+    std::vector<cv::cuda::GpuMat> g_planes;
+    cv::cuda::Stream stream;
+#endif
+};
+
+PoseEngine::PoseEngine() = default;
+PoseEngine::~PoseEngine() = default;
+
+bool PoseEngine::Load(const NativeEngineConfig& config, std::string& error) {
+    config_ = config;
+    backend_.reset();
+    if (config.model_path.empty()) { error = "no model configured"; return false; }
+    if (!ProviderAvailable(config.provider)) { error = std::string(kProviderNames[config.provider]) + " provider is not built in"; return false; }
+    if (!PreprocessAvailable(config.preprocess)) { error = std::string(kPreprocessNames[config.preprocess]) + " preprocessing is not available (not built in or no device)"; return false; }
+    device_.reset(config.preprocess != PREPROCESS_CPU ? new DeviceBuffers() : nullptr);
+    if (config.preprocess == PREPROCESS_OPENCL) cv::ocl::setUseOpenCL(true);
+    // RTMPose expects ImageNet mean/std in RGB order, BlazePose [0, 1]
+    static const float kMean[3] = { 123.675f, 116.28f, 103.53f }, kStd[3] = { 58.395f, 57.12f, 57.375f };
+    for (int c = 0; c < 3; c++) {
+        norm_scale_[c] = config.format == MODEL_SIMCC ? 1.0f / kStd[c] : 1.0f / 255.0f;
+        norm_offset_[c] = config.format == MODEL_SIMCC ? -kMean[c] / kStd[c] : 0.0f;
+    }
+#ifdef POSEBRIDGE_HAS_TENSORRT
+    if (config.provider == PROVIDER_TENSORRT) {
+        auto b = std::make_unique<TensorRtBackend>();
+        if (!b->Load(config, error)) return false;
+        backend_ = std::move(b);
+    }
+#endif
+#ifdef POSEBRIDGE_HAS_ONNXRUNTIME
+    if (config.provider != PROVIDER_TENSORRT) {
+        auto b = std::make_unique<OrtBackend>();
+        if (!b->Load(config, error)) return false;
+        backend_ = std::move(b);
+    }
+#endif
+    if (!backend_) { error = "no inference runtime built in"; return false; }
+    const std::vector<int64_t>& s = backend_->InputShape();
+    if (s.size() == 4 && s[1] == 3) { nchw_ = true; in_h_ = (int)s[2]; in_w_ = (int)s[3]; }
+    else if (s.size() == 4 && s[3] == 3) { nchw_ = false; in_h_ = (int)s[1]; in_w_ = (int)s[2]; }
+    else { error = "expected a 3-channel NCHW or NHWC input"; return false; }
+    fixed_batch_ = s[0] > 0 ? (int)s[0] : 0;
+    return true;
+}
+
+float PoseEngine::Preprocess(const cv::Mat& bgr, float* dst) {
+    // Top-left anchored letterbox, so mapping back is a single scale
+    float scale = std::min(in_w_ / (float)bgr.cols, in_h_ / (float)bgr.rows);
+    int w = std::clamp((int)std::lround(bgr.cols * scale), 1, in_w_);
+    int h = std::clamp((int)std::lround(bgr.rows * scale), 1, in_h_);
+    if (config_.preprocess == PREPROCESS_OPENCL) { PreprocessOpenCl(bgr, w, h, dst); return scale; }
+    if (config_.preprocess == PREPROCESS_CUDA) { PreprocessCuda(bgr, w, h, dst); return scale; }
+    // Resized straight into the letterbox; only the padding strips are cleared
+    padded_.create(in_h_, in_w_, CV_8UC3);
+    cv::Mat fit = padded_(cv::Rect(0, 0, w, h));
+    cv::resize(bgr, fit, cv::Size(w, h), 0, 0, cv::INTER_LINEAR);
+    if (w < in_w_) padded_(cv::Rect(w, 0, in_w_ - w, in_h_)).setTo(cv::Scalar(0, 0, 0));
+    if (h < in_h_) padded_(cv::Rect(0, h, w, in_h_ - h)).setTo(cv::Scalar(0, 0, 0));
+    size_t plane = size_t(in_w_) * in_h_;
+    for (int y = 0; y < in_h_; y++) {
+        const uchar* row = padded_.ptr<uchar>(y);
+        for (int x = 0; x < in_w_; x++) {
+            size_t px = size_t(y) * in_w_ + x;
+            for (int c = 0; c < 3; c++) {
+                float v = row[x * 3 + (2 - c)] * norm_scale_[c] + norm_offset_[c]; // BGR -> RGB
+                dst[nchw_ ? c * plane + px : px * 3 + c] = v;
+            }
+        }
+    }
+    return scale;
+}
+
+void PoseEngine::PreprocessOpenCl(const cv::Mat& bgr, int w, int h, float* dst) {
+    DeviceBuffers& d = *device_;
+    // getUMat maps the frame rather than copying it where the device shares host memory
+    cv::UMat src = bgr.getUMat(cv::ACCESS_READ);
+    d.padded.create(in_h_, in_w_, CV_8UC3);
+    // As on the CPU path, only the padding strips are cleared
+    cv::UMat fit = d.padded(cv::Rect(0, 0, w, h));
+    cv::resize(src, fit, cv::Size(w, h), 0, 0, cv::INTER_LINEAR);
+    if (w < in_w_) d.padded(cv::Rect(w, 0, in_w_ - w, in_h_)).setTo(cv::Scalar::all(0));
+    if (h < in_h_) d.padded(cv::Rect(0, h, w, in_h_ - h)).setTo(cv::Scalar::all(0));
+    cv::cvtColor(d.padded, d.rgb, cv::COLOR_BGR2RGB);
+    d.rgb.convertTo(d.normalized, CV_32F);
+    cv::multiply(d.normalized, cv::Scalar(norm_scale_[0], norm_scale_[1], norm_scale_[2]), d.normalized);
+    cv::add(d.normalized, cv::Scalar(norm_offset_[0], norm_offset_[1], norm_offset_[2]), d.normalized);
+    if (!nchw_) { cv::Mat out(in_h_, in_w_, CV_32FC3, dst); d.normalized.copyTo(out); return; }
+    cv::split(d.normalized, d.planes);
+    for (int c = 0; c < 3; c++) { cv::Mat out(in_h_, in_w_, CV_32F, dst + size_t(c) * in_w_ * in_h_); d.planes[c].copyTo(out); }
+}
+
+void PoseEngine::PreprocessCuda(const cv::Mat& bgr, int w, int h, float* dst) {
+#ifdef POSEBRIDGE_HAS_OPENCV_CUDA
+    DeviceBuffers& d = *device_;
+    d.g_src.upload(bgr, d.stream);
+    d.g_padded.create(in_h_, in_w_, CV_8UC3);
+    cv::cuda::GpuMat fit = d.g_padded(cv::Rect(0, 0, w, h));
+    cv::cuda::resize(d.g_src, fit, cv::Size(w, h), 0, 0, cv::INTER_LINEAR, d.stream);
+    if (w < in_w_) d.g_padded(cv::Rect(w, 0, in_w_ - w, in_h_)).setTo(cv::Scalar::all(0), d.stream);
+    if (h < in_h_) d.g_padded(cv::Rect(0, h, w, in_h_ - h)).setTo(cv::Scalar::all(0), d.stream);
+    cv::cuda::cvtColor(d.g_padded, d.g_rgb, cv::COLOR_BGR2RGB, 0, d.stream);
+    d.g_rgb.convertTo(d.g_normalized, CV_32F, d.stream);
+    cv::cuda::multiply(d.g_normalized, cv::Scalar(norm_scale_[0], norm_scale_[1], norm_scale_[2]), d.g_normalized, 1, -1, d.stream);
+    cv::cuda::add(d.g_normalized, cv::Scalar(norm_offset_[0], norm_offset_[1], norm_offset_[2]), d.g_normalized, cv::noArray(), -1, d.stream);
+    if (!nchw_) { cv::Mat out(in_h_, in_w_, CV_32FC3, dst); d.g_normalized.download(out, d.stream); }
+    else {
+        cv::cuda::split(d.g_normalized, d.g_planes, d.stream);
+        for (int c = 0; c < 3; c++) { cv::Mat out(in_h_, in_w_, CV_32F, dst + size_t(c) * in_w_ * in_h_); d.g_planes[c].download(out, d.stream); }
+    }
+    d.stream.waitForCompletion();
+#else
+    (void)bgr; (void)w; (void)h; (void)dst; // Load refuses PREPROCESS_CUDA without the modules
+#endif
+}
+
+bool PoseEngine::Decode(size_t item, float scale, const cv::Mat& bgr, EngineResult& out) const {
+    float sx = 1.0f / (scale * bgr.cols), sy = 1.0f / (scale * bgr.rows); // model pixels -> normalized image
+    out.keypoints.clear();
+    out.preview.release();
+    int count = 0;
+    float score_sum = 0.0f;
+    if (config_.format == MODEL_SIMCC) {
+        if (outputs_.size() < 2 || outputs_[0].shape.size() != 3 || outputs_[1].shape.size() != 3) return false;
+        const Tensor& tx = outputs_[0]; const Tensor& ty = outputs_[1];
+        count = (int)tx.shape[1];
+        int64_t lx = tx.shape[2], ly = ty.shape[2];
+        float ratio_x = (float)lx / in_w_, ratio_y = (float)ly / in_h_; // SimCC split ratio, 2.0 for RTMPose
+        const float* bx = tx.data.data() + item * count * lx; const float* by = ty.data.data() + item * count * ly;
+        for (int k = 0; k < count; k++) {
+            const float* rx = bx + k * lx; const float* ry = by + k * ly;
+            const float* mx = std::max_element(rx, rx + lx); const float* my = std::max_element(ry, ry + ly);
+            float score = std::min(*mx, *my);
+            out.keypoints.insert(out.keypoints.end(), { (mx - rx) / ratio_x * sx, (my - ry) / ratio_y * sy, 0.0f, score });
+            score_sum += score;
+        }
+    }
+    else {
+        if (outputs_.empty() || outputs_[0].shape.empty()) return false;
+        const Tensor& t = outputs_[0];
+        size_t stride = t.data.size() / size_t(std::max<int64_t>(1, t.shape[0]));
+        // 39 landmarks: 33 body points, then 6 auxiliary ones that are dropped
+        count = std::min((int)(stride / 5), 33);
+        const float* base = t.data.data() + item * stride;
+        for (int k = 0; k < count; k++) {
+            const float* l = base + k * 5;
+            float vis = 1.0f / (1.0f + std::exp(-l[3]));
+            out.keypoints.insert(out.keypoints.end(), { l[0] * sx, l[1] * sy, l[2] * sx, vis });
+            score_sum += vis;
+        }
+    }
+    out.header = PoseHeader{};
+    out.header.magic = kPoseMagic;
+    out.header.version = kPoseVersion;
+    out.header.header_size = sizeof(PoseHeader);
+    out.header.keypoint_count = (uint16_t)count;
+    out.header.components = 4;
+    out.header.layout = POSE_LAYOUT_IMAGE_XYZV;
+    out.header.person_count = count > 0 && score_sum / count >= config_.min_score ? 1 : 0;
+    if (!out.header.person_count) out.keypoints.clear();
+    return true;
+}
+
+bool PoseEngine::InferBatch(const std::vector<EngineFrame>& frames, std::vector<EngineResult>& results) {
+    if (!backend_) return false;
+    for (const EngineFrame& f : frames) if (f.image.empty() || f.image.type() != CV_8UC3) return false;
+    results.resize(frames.size());
+    size_t per_item = size_t(3) * in_w_ * in_h_;
+    // A fixed-batch model runs in chunks of its size, zero-padding the last one
+    size_t chunk = fixed_batch_ > 0 ? (size_t)fixed_batch_ : std::max<size_t>(1, frames.size());
+    for (size_t base = 0; base < frames.size(); base += chunk) {
+        size_t n = std::min(chunk, frames.size() - base);
+        size_t run = fixed_batch_ > 0 ? chunk : n;
+        input_.resize(run * per_item);
+        scales_.resize(n);
+        for (size_t i = 0; i < n; i++) scales_[i] = Preprocess(frames[base + i].image, input_.data() + i * per_item);
+        std::fill(input_.begin() + n * per_item, input_.end(), 0.0f);
+        if (!backend_->Run(input_, (int)run, outputs_)) return false;
+        for (size_t i = 0; i < n; i++) if (!Decode(i, scales_[i], frames[base + i].image, results[base + i])) return false;
+    }
+    return true;
+}
+
+// --- 4. Engine Thread ---
+void NativeEngineThread() {
+    NativeEngineConfig config = app.native_engine;
+    app.Log("[SYS] Loading native engine: " + config.model_path);
+    PoseEngine engine;
+    std::string error;
+    if (!engine.Load(config, error)) { app.Log("[ERR] Native engine: " + error); app.backend_running = false; return; }
+    app.Log(std::string("[SYS] Native engine ready (") + engine.BackendName() + ", " + kModelFormatNames[config.format] + ")");
+
+    BatchScheduler::Limits limits{ config.max_batch, config.max_delay_us, config.stale_us };
+    // Gathering more frames than one pass takes would only add latency
+    if (engine.FixedBatch() > 0) limits.max_batch = std::min(limits.max_batch, engine.FixedBatch());
+    app.engine_frames.Configure(limits);
+    app.engine_frames.Clear();
+    std::vector<EngineFrame> batch;
+    std::vector<EngineResult> results;
+    bool failure_logged = false;
+    // The dispatching thread only; ONNX Runtime's intra-op pool keeps its own scheduling
+    ThreadTuner tuner(ROLE_INFERENCE);
+    while (app.is_running && !app.engine_stop) {
+        tuner.Poll();
+        if (!app.engine_frames.PopBatch(batch, app.ActiveSourceCount(), std::chrono::milliseconds(100))) continue;
+        int64_t recv_us = WallClockMicros();
+        if (!engine.InferBatch(batch, results)) {
+            if (!failure_logged) { app.Log("[ERR] Native inference failed (model outputs do not match the configured format?)"); failure_logged = true; }
+            continue;
+        }
+        int64_t done_us = WallClockMicros();
+        app.count_batches++;
+        app.count_batched_frames += batch.size();
+        // Results go back out per source; ReceiverThread routes them by source_id
+        for (size_t i = 0; i < batch.size(); i++) {
+            const EngineFrame& f = batch[i];
+            EngineResult& r = results[i];
+            r.header.frame_id = f.frame_id;
+            r.header.capture_us = f.capture_us;
+            r.header.inference_us = done_us;
+            r.header.engine_recv_us = recv_us;
+            r.header.source_id = (uint16_t)f.source_id;
+            if (app.EnginePreviewWanted() && f.source_id == app.PreviewSource()) {
+                r.preview = f.image.clone();
+                for (size_t k = 0; k + 3 < r.keypoints.size(); k += 4) {
+                    if (r.keypoints[k + 3] < config.min_score) continue;
+                    cv::Point p((int)(r.keypoints[k] * f.image.cols), (int)(r.keypoints[k + 1] * f.image.rows));
+                    cv::circle(r.preview, p, 4, cv::Scalar(0, 255, 0), cv::FILLED, cv::LINE_AA);
+                }
+            }
+            // Keypoints leave the engine normalized to the whole sensor frame, whatever crop it ran on
+            cv::Size full = f.crop.empty() ? f.image.size() : f.full;
+            if (!f.crop.empty()) {
+                float sx = (float)f.crop.width / full.width, sy = (float)f.crop.height / full.height;
+                float ox = (float)f.crop.x / full.width, oy = (float)f.crop.y / full.height;
+                for (size_t k = 0; k + 3 < r.keypoints.size(); k += 4) { r.keypoints[k] = ox + r.keypoints[k] * sx; r.keypoints[k + 1] = oy + r.keypoints[k + 1] * sy; }
+            }
+            if (r.header.person_count > 0) r.person_box = KeypointBox(r.keypoints.data(), r.header.keypoint_count, 4, full, config.min_score);
+            app.engine_results.Push(std::move(r));
+        }
+    }
+    app.backend_running = false;
+    app.Log("[SYS] Native engine stopped.");
+}
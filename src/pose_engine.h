@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "pose_format.h"
+
+// In-process pose inference: an alternative to scripts/engine.py that takes
+// frames straight from the capture workers and hands poses to ReceiverThread,
+// with no JPEG or ZMQ hop in between.
+
+enum EngineKind {
+    ENGINE_PYTHON = 0, // scripts/engine.py over ZMQ
+    ENGINE_NATIVE = 1  // PoseEngine in this process
+};
+
+enum PoseModelFormat {
+    MODEL_SIMCC = 0,    // RTMPose-style: NCHW mean/std input, simcc_x / simcc_y outputs
+    MODEL_BLAZEPOSE = 1 // BlazePose landmark: NHWC [0,1] input, (x, y, z, visibility, presence) per landmark
+};
+
+enum InferenceProvider {
+    PROVIDER_ORT_CPU = 0,
+    PROVIDER_ORT_CUDA,
+    PROVIDER_ORT_DIRECTML,
+    PROVIDER_TENSORRT, // serialized TensorRT engine (.engine / .plan)
+    PROVIDER_COUNT
+};
+
+// Where letterboxing, BGR -> RGB and normalization of the model input run
+enum PreprocessDevice {
+    PREPROCESS_CPU = 0,
+    PREPROCESS_OPENCL, // OpenCV T-API (cv::UMat); needs an OpenCL-enabled OpenCV build and device
+    PREPROCESS_CUDA,   // OpenCV CUDA modules, POSEBRIDGE_WITH_OPENCV_CUDA
+    PREPROCESS_DEVICE_COUNT
+};
+
+extern const char* kModelFormatNames[2];
+extern const char* kProviderNames[PROVIDER_COUNT];
+extern const char* kPreprocessNames[PREPROCESS_DEVICE_COUNT];
+
+struct NativeEngineConfig {
+    std::string model_path;
+    PoseModelFormat format = MODEL_SIMCC;
+    InferenceProvider provider = PROVIDER_ORT_CPU;
+    float min_score = 0.3f; // mean keypoint score below this reports no person
+    int threads = 0;        // ORT intra-op threads, 0 = library default
+    PreprocessDevice preprocess = PREPROCESS_CPU;
+    // Batch scheduling across sources, see BatchScheduler
+    int max_batch = 4;
+    int64_t max_delay_us = 2000;
+    int64_t stale_us = 100000;
+};
+
+// Capture worker -> engine
+struct EngineFrame {
+    cv::Mat image;
+    uint64_t frame_id = 0;
+    int64_t capture_us = 0;
+    int source_id = 0;
+    cv::Rect crop; // where `image` sits in the sensor frame; empty if it is the whole frame
+    cv::Size full;
+};
+
+// Engine -> ReceiverThread, in the same shape as a parsed pose packet
+struct EngineResult {
+    PoseHeader header{};
+    std::vector<float> keypoints;
+    cv::Mat preview; // empty unless previews are shown
+    cv::Rect person_box; // first person, in sensor-frame pixels; empty if nobody was found
+};
+
+struct Tensor {
+    std::vector<int64_t> shape;
+    std::vector<float> data;
+};
+
+// A model's bare forward pass on one runtime
+class InferenceBackend {
+public:
+    virtual ~InferenceBackend() = default;
+    virtual const char* Name() const = 0;
+    // Shape of the single float input; a batch dimension below 1 means dynamic
+    virtual const std::vector<int64_t>& InputShape() const = 0;
+    // `input` holds `batch` images. `outputs` is resized to the model's output
+    // count, each leading with the batch dimension; its buffers are reused between calls
+    virtual bool Run(const std::vector<float>& input, int batch, std::vector<Tensor>& outputs) = 0;
+};
+
+bool ProviderAvailable(InferenceProvider provider);
+bool PreprocessAvailable(PreprocessDevice device);
+
+// Pre/post-processing around an InferenceBackend for the supported model formats
+class PoseEngine {
+public:
+    PoseEngine();
+    ~PoseEngine();
+    bool Load(const NativeEngineConfig& config, std::string& error);
+    // Batch size the model is built for, 0 if its batch dimension is dynamic
+    int FixedBatch() const { return fixed_batch_; }
+    // Runs `frames` in as few forward passes as the model allows. results[i]
+    // gets frames[i]'s counts, layout and keypoints in POSE_LAYOUT_IMAGE_XYZV.
+    bool InferBatch(const std::vector<EngineFrame>& frames, std::vector<EngineResult>& results);
+    const char* BackendName() const { return backend_ ? backend_->Name() : "none"; }
+
+private:
+    // Letterboxes one image into `dst`; returns model pixels per image pixel
+    float Preprocess(const cv::Mat& bgr, float* dst);
+    void PreprocessOpenCl(const cv::Mat& bgr, int w, int h, float* dst);
+    void PreprocessCuda(const cv::Mat& bgr, int w, int h, float* dst);
+    bool Decode(size_t item, float scale, const cv::Mat& bgr, EngineResult& out) const;
+
+    NativeEngineConfig config_;
+    std::unique_ptr<InferenceBackend> backend_;
+    int in_w_ = 0, in_h_ = 0;
+    int fixed_batch_ = 0;
+    bool nchw_ = true;
+    cv::Mat padded_;
+    // Per-channel input = pixel * scale + offset, RGB order
+    float norm_scale_[3] = {}, norm_offset_[3] = {};
+    struct DeviceBuffers; // GPU working images, kept between frames
+    std::unique_ptr<DeviceBuffers> device_;
+    std::vector<float> input_;
+    std::vector<float> scales_;
+    std::vector<Tensor> outputs_;
+};
+
+// Runs the configured PoseEngine on batches from app.engine_frames until StopBackend()
+void NativeEngineThread();
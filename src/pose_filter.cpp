@@ -0,0 +1,90 @@
+#include "pose_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Smoothing factor of a first-order low-pass at `cutoff` Hz for a step of `dt` seconds
+static inline float Alpha(float cutoff, float dt) {
+    float tau = 1.0f / (6.2831853f * cutoff);
+    return 1.0f / (1.0f + tau / dt);
+}
+
+void PoseFilter::Update(const PoseHeader& header, const float* keypoints, size_t count, const PoseFilterParams& params) {
+    size_t components = header.components;
+    size_t points = components ? std::min(size_t(header.person_count) * header.keypoint_count, count / components) : 0;
+    bool same_shape = samples_ > 0 && points == points_ && header.components == header_.components && header.layout == header_.layout
+        && header.person_count == header_.person_count && header.keypoint_count == header_.keypoint_count;
+    float dt = float(header.capture_us - last_us_) * 1e-6f;
+    // Out-of-order or duplicate stamps cannot be filtered; start over from this sample
+    if (!same_shape || dt <= 0.0f) samples_ = 0;
+
+    header_ = header;
+    points_ = points;
+    last_us_ = header.capture_us;
+    int axes = (int)std::min<size_t>(kAxes, components);
+    size_t rest = components > kAxes ? components - kAxes : 0;
+    rest_.resize(points * rest);
+    for (size_t i = 0; i < points; i++)
+        for (size_t c = 0; c < rest; c++) rest_[i * rest + c] = keypoints[i * components + kAxes + c];
+
+    for (int a = 0; a < axes; a++) {
+        raw_[a].resize(points);
+        value_[a].resize(points);
+        deriv_[a].resize(points);
+        float* raw = raw_[a].data();
+        for (size_t i = 0; i < points; i++) raw[i] = keypoints[i * components + a];
+    }
+    if (samples_++ == 0) {
+        for (int a = 0; a < axes; a++) {
+            std::copy(raw_[a].begin(), raw_[a].end(), value_[a].begin());
+            std::fill(deriv_[a].begin(), deriv_[a].end(), 0.0f);
+        }
+        return;
+    }
+
+    float ad = Alpha(params.d_cutoff, dt);
+    float inv_dt = 1.0f / dt;
+    for (int a = 0; a < axes; a++) {
+        const float* raw = raw_[a].data();
+        float* value = value_[a].data();
+        float* deriv = deriv_[a].data();
+        for (size_t i = 0; i < points; i++) {
+            float d = deriv[i] + ad * ((raw[i] - value[i]) * inv_dt - deriv[i]);
+            float cutoff = params.min_cutoff + params.beta * std::fabs(d);
+            deriv[i] = d;
+            value[i] += Alpha(cutoff, dt) * (raw[i] - value[i]);
+        }
+    }
+}
+
+bool PoseFilter::Predict(int64_t target_us, const PoseFilterParams& params, PoseSample& out) const {
+    if (samples_ == 0) return false;
+    out.header = header_;
+    size_t components = header_.components;
+    out.keypoints.resize(points_ * components);
+    float ahead = float(std::clamp<int64_t>(target_us - last_us_, 0, params.max_predict_us)) * 1e-6f;
+    int axes = (int)std::min<size_t>(kAxes, components);
+    for (int a = 0; a < axes; a++) {
+        const float* value = value_[a].data();
+        const float* deriv = deriv_[a].data();
+        for (size_t i = 0; i < points_; i++) out.keypoints[i * components + a] = value[i] + deriv[i] * ahead;
+    }
+    size_t rest = components > kAxes ? components - kAxes : 0;
+    for (size_t i = 0; i < points_; i++)
+        for (size_t c = 0; c < rest; c++) out.keypoints[i * components + kAxes + c] = rest_[i * rest + c];
+    return true;
+}
+
+void PoseFilterBank::Update(const PoseHeader& header, const float* keypoints, size_t count) {
+    if (header.source_id >= kSources) return;
+    PoseFilterParams params = Params();
+    std::lock_guard<std::mutex> lock(mutex_[header.source_id]);
+    filters_[header.source_id].Update(header, keypoints, count, params);
+}
+
+bool PoseFilterBank::Predict(int source, int64_t target_us, PoseSample& out) const {
+    if (source < 0 || source >= kSources) return false;
+    PoseFilterParams params = Params();
+    std::lock_guard<std::mutex> lock(mutex_[source]);
+    return filters_[source].Predict(target_us, params, out);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "pose_format.h"
+#include "pose_output.h"
+
+// Temporal smoothing and prediction of received poses. Every keypoint axis is
+// a One-Euro filter (a low-pass whose cutoff rises with speed, so slow
+// motion is steady and fast motion does not lag), and its filtered
+// derivative drives a constant-velocity predictor. A pose can then be asked
+// for at any wall-clock time, e.g. when a sink sends it, which hides the
+// capture-to-output latency from the consumer.
+
+struct PoseFilterParams {
+    float min_cutoff = 1.0f;         // Hz, cutoff at rest: lower = smoother
+    float beta = 0.5f;               // cutoff increase per unit/s of speed: higher = less lag
+    float d_cutoff = 1.0f;           // Hz, cutoff of the derivative
+    int64_t max_predict_us = 100000; // extrapolation horizon past the newest sample
+};
+
+// One source's filter state. Axes are stored structure-of-arrays, one
+// contiguous float array per axis, so each update is a branch-free loop over
+// all keypoints of all people that the compiler can vectorize.
+class PoseFilter {
+public:
+    void Reset() { samples_ = 0; }
+    // Feeds a pose stamped with its header's capture_us. A change in layout,
+    // people or keypoint count restarts the filter from this sample.
+    void Update(const PoseHeader& header, const float* keypoints, size_t count, const PoseFilterParams& params);
+    // Filtered pose extrapolated to `target_us` (clamped to max_predict_us past
+    // the newest sample), in the input layout. Returns false before the first sample.
+    bool Predict(int64_t target_us, const PoseFilterParams& params, PoseSample& out) const;
+
+private:
+    static constexpr int kAxes = 3; // x, y, z; further components pass through
+
+    PoseHeader header_{};
+    int64_t last_us_ = 0;
+    uint64_t samples_ = 0;
+    size_t points_ = 0;
+    std::array<std::vector<float>, kAxes> raw_, value_, deriv_;
+    std::vector<float> rest_; // components past z, latest value
+};
+
+// A PoseFilter per source, shared by ReceiverThread (Update) and any number of readers
+class PoseFilterBank {
+public:
+    std::atomic<bool> enabled{ false };
+    std::atomic<int64_t> lead_us{ 0 }; // sinks predict to their send time plus this
+
+    PoseFilterParams Params() const { std::lock_guard<std::mutex> lock(params_mutex_); return params_; }
+    void SetParams(const PoseFilterParams& params) { std::lock_guard<std::mutex> lock(params_mutex_); params_ = params; }
+
+    void Update(const PoseHeader& header, const float* keypoints, size_t count);
+    bool Predict(int source, int64_t target_us, PoseSample& out) const;
+
+private:
+    static constexpr int kSources = 8;
+
+    mutable std::mutex params_mutex_;
+    PoseFilterParams params_;
+    mutable std::mutex mutex_[kSources];
+    PoseFilter filters_[kSources];
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Binary pose packet, frame 1 of the multipart on the pose channel (frame 0
+// stays a small JSON summary). Little-endian, fixed layout, mirrored in
+// scripts/engine.py:
+//   PoseHeader
+//   person_count * keypoint_count * components float32, starting at header_size
+// Readers must skip to header_size, so later versions can append header fields
+// without breaking older consumers.
+
+constexpr uint32_t kPoseMagic = 0x53504250; // "PBPS"
+constexpr uint16_t kPoseVersion = 2;
+constexpr size_t kPoseHeaderV1Size = 40; // v2 appended engine_recv_us
+
+enum PoseLayout : uint8_t {
+    POSE_LAYOUT_WORLD_XYZV = 0, // metric, hip-centred (x, y, z, visibility)
+    POSE_LAYOUT_IMAGE_XYZV = 1  // normalized image coords, relative depth (x, y, z, visibility)
+};
+
+struct PoseHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint64_t frame_id;       // CameraThread sequence of the source frame
+    int64_t capture_us;      // wall clock, see clock.h
+    int64_t inference_us;    // wall clock when inference finished
+    uint16_t person_count;
+    uint16_t keypoint_count; // per person
+    uint8_t components;      // floats per keypoint
+    uint8_t layout;          // PoseLayout
+    uint16_t source_id;      // camera the frame came from (formerly reserved, 0 for a single view)
+    int64_t engine_recv_us;  // v2: wall clock when the engine received the frame, 0 if unknown
+};
+static_assert(sizeof(PoseHeader) == 48, "PoseHeader layout is shared with engine.py");
+
+// Non-owning view into a received packet.
+struct PoseView {
+    PoseHeader header{};
+    const float* keypoints = nullptr;
+
+    size_t FloatCount() const { return size_t(header.person_count) * header.keypoint_count * header.components; }
+};
+
+// Validates and maps a packet in place. No allocation; `data` must outlive the view.
+inline bool ParsePosePacket(const void* data, size_t size, PoseView& out) {
+    if (size < kPoseHeaderV1Size) return false;
+    uint16_t header_size;
+    std::memcpy(&header_size, static_cast<const uint8_t*>(data) + 6, sizeof(header_size));
+    if (header_size < kPoseHeaderV1Size || header_size > size) return false;
+    // Older senders leave the fields they don't know about zeroed
+    out.header = PoseHeader{};
+    std::memcpy(&out.header, data, header_size < sizeof(PoseHeader) ? header_size : sizeof(PoseHeader));
+    const PoseHeader& h = out.header;
+    if (h.magic != kPoseMagic || h.version == 0 || h.components == 0) return false;
+    if (size_t(h.header_size) + out.FloatCount() * sizeof(float) > size) return false;
+    out.keypoints = reinterpret_cast<const float*>(static_cast<const uint8_t*>(data) + h.header_size);
+    return true;
+}
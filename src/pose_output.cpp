@@ -0,0 +1,387 @@
+#include "pose_output.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include "app_state.h"
+#include "clock.h"
+#include "pose_codec.h"
+#include "shm_ring.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef POSEBRIDGE_HAS_ROS2
+#include <geometry_msgs/msg/transform_stamped.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <sensor_msgs/point_cloud2_iterator.hpp>
+#include <tf2_ros/transform_broadcaster.h>
+#endif
+
+const char* kPoseSinkNames[SINK_COUNT] = { "openvr", "ros2", "vmc", "udp", "compact" };
+const char* kPoseSinkDefaultTargets[SINK_COUNT] = { "posebridge_pose", "posebridge/keypoints", "127.0.0.1:39539", "127.0.0.1:9100", "127.0.0.1:9101" };
+
+// --- UDP transport (VMC, raw packets) ---
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+static const SocketHandle kNoSocket = INVALID_SOCKET;
+static void CloseSocket(SocketHandle s) { closesocket(s); }
+#else
+using SocketHandle = int;
+static const SocketHandle kNoSocket = -1;
+static void CloseSocket(SocketHandle s) { close(s); }
+#endif
+
+// Connected datagram socket, so each Send is a single send() with no address lookup
+class UdpSender {
+public:
+    ~UdpSender() { if (sock_ != kNoSocket) CloseSocket(sock_); }
+
+    bool Open(const std::string& target, std::string& error) {
+        size_t colon = target.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == target.size()) { error = "expected host:port, got " + target; return false; }
+#ifdef _WIN32
+        static const bool wsa_ready = [] { WSADATA wsa; return WSAStartup(MAKEWORD(2, 2), &wsa) == 0; }();
+        if (!wsa_ready) { error = "WSAStartup failed"; return false; }
+#endif
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* res = nullptr;
+        if (getaddrinfo(target.substr(0, colon).c_str(), target.substr(colon + 1).c_str(), &hints, &res) != 0 || !res) { error = "cannot resolve " + target; return false; }
+        sock_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        bool ok = sock_ != kNoSocket && connect(sock_, res->ai_addr, (int)res->ai_addrlen) == 0;
+        freeaddrinfo(res);
+        if (!ok) { error = "cannot open UDP socket to " + target; return false; }
+        return true;
+    }
+
+    bool Send(const void* data, size_t size) {
+        return send(sock_, static_cast<const char*>(data), (int)size, 0) == (int)size;
+    }
+
+private:
+    SocketHandle sock_ = kNoSocket;
+};
+
+// --- Sinks ---
+
+// Same bytes as frame 1 of the pose channel, so consumers reuse ParsePosePacket
+class UdpPoseSink : public PoseSink {
+public:
+    bool Open(const std::string& target, std::string& error) override { return udp_.Open(target, error); }
+
+    bool Send(const PoseSample& pose) override {
+        PoseHeader h = pose.header;
+        h.header_size = sizeof(PoseHeader);
+        packet_.resize(sizeof(PoseHeader) + pose.keypoints.size() * sizeof(float));
+        std::memcpy(packet_.data(), &h, sizeof(PoseHeader));
+        if (!pose.keypoints.empty()) std::memcpy(packet_.data() + sizeof(PoseHeader), pose.keypoints.data(), pose.keypoints.size() * sizeof(float));
+        return udp_.Send(packet_.data(), packet_.size());
+    }
+
+private:
+    UdpSender udp_;
+    std::vector<uint8_t> packet_;
+};
+
+// Quantized keyframes and deltas for Wi-Fi / WAN consumers, decoded by PoseDecoder
+// or scripts/pose_compact.py. Encoder settings are re-read per pose.
+class CompactPoseSink : public PoseSink {
+public:
+    bool Open(const std::string& target, std::string& error) override { return udp_.Open(target, error); }
+
+    bool Send(const PoseSample& pose) override {
+        encoder_.SetParams(app.compact_keyframe_interval, app.compact_deadband);
+        if (!encoder_.Encode(pose.header, pose.keypoints.data(), pose.keypoints.size(), packet_)) return false;
+        return udp_.Send(packet_.data(), packet_.size());
+    }
+
+private:
+    UdpSender udp_;
+    PoseEncoder encoder_;
+    std::vector<uint8_t> packet_;
+};
+
+// Minimal OSC 1.0 encoder: big-endian, every field padded to 4 bytes
+class OscWriter {
+public:
+    void Clear() { buf_.clear(); }
+    const std::vector<uint8_t>& Bytes() const { return buf_; }
+
+    void BeginBundle() { String("#bundle"); Int(0); Int(1); } // time tag 1 = immediately
+    // Opens a bundle element; BeginMessage's return value goes to EndMessage
+    size_t BeginMessage(const char* address, const char* tags) { size_t at = buf_.size(); Int(0); String(address); String(tags); return at; }
+    void EndMessage(size_t at) { Put32(at, uint32_t(buf_.size() - at - 4)); }
+
+    void String(const char* s) { buf_.insert(buf_.end(), s, s + std::strlen(s) + 1); while (buf_.size() % 4) buf_.push_back(0); }
+    void Int(int32_t v) { buf_.resize(buf_.size() + 4); Put32(buf_.size() - 4, uint32_t(v)); }
+    void Float(float f) { uint32_t v; std::memcpy(&v, &f, 4); buf_.resize(buf_.size() + 4); Put32(buf_.size() - 4, v); }
+
+private:
+    void Put32(size_t at, uint32_t v) { buf_[at] = uint8_t(v >> 24); buf_[at + 1] = uint8_t(v >> 16); buf_[at + 2] = uint8_t(v >> 8); buf_[at + 3] = uint8_t(v); }
+
+    std::vector<uint8_t> buf_;
+};
+
+// Each keypoint of the first person as a VMC virtual tracker (/VMC/Ext/Tra/Pos),
+// one OSC bundle per pose. VMC receivers are Unity-space: y up, z forward,
+// so y and z are flipped from the image-style axes the engines produce.
+class VmcPoseSink : public PoseSink {
+public:
+    bool Open(const std::string& target, std::string& error) override {
+        start_us_ = WallClockMicros();
+        return udp_.Open(target, error);
+    }
+
+    bool Send(const PoseSample& pose) override {
+        const PoseHeader& h = pose.header;
+        osc_.Clear();
+        osc_.BeginBundle();
+        size_t m = osc_.BeginMessage("/VMC/Ext/OK", ",i"); osc_.Int(h.person_count > 0 ? 1 : 0); osc_.EndMessage(m);
+        m = osc_.BeginMessage("/VMC/Ext/T", ",f"); osc_.Float(float(double(h.capture_us - start_us_) * 1e-6)); osc_.EndMessage(m);
+        if (h.person_count > 0 && h.components >= 3) {
+            for (int k = 0; k < h.keypoint_count; k++) {
+                const float* p = pose.keypoints.data() + size_t(k) * h.components;
+                char serial[32];
+                snprintf(serial, sizeof(serial), "PoseBridge_%u_%d", (unsigned)h.source_id, k);
+                m = osc_.BeginMessage("/VMC/Ext/Tra/Pos", ",sfffffff");
+                osc_.String(serial);
+                osc_.Float(p[0]); osc_.Float(-p[1]); osc_.Float(-p[2]);
+                osc_.Float(0.0f); osc_.Float(0.0f); osc_.Float(0.0f); osc_.Float(1.0f);
+                osc_.EndMessage(m);
+            }
+        }
+        return udp_.Send(osc_.Bytes().data(), osc_.Bytes().size());
+    }
+
+private:
+    UdpSender udp_;
+    OscWriter osc_;
+    // /VMC/Ext/T counts from here: a float keeps sub-millisecond steps for the first two hours
+    int64_t start_us_ = 0;
+};
+
+// Latest pose per source in a PoseShmHeader block, see pose_output.h
+class OpenVrShmSink : public PoseSink {
+public:
+    bool Open(const std::string& target, std::string& error) override {
+        if (!region_.Create(target, sizeof(PoseShmHeader) + kPoseShmSources * sizeof(PoseShmSource))) { error = "cannot create shared memory " + target; return false; }
+        PoseShmHeader* hdr = new (region_.Data()) PoseShmHeader();
+        hdr->magic = kPoseShmMagic;
+        hdr->version = kPoseShmVersion;
+        hdr->source_count = kPoseShmSources;
+        hdr->max_floats = kPoseShmMaxFloats;
+        hdr->write_count.store(0, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < kPoseShmSources; i++) new (Source(i)) PoseShmSource();
+        return true;
+    }
+
+    bool Send(const PoseSample& pose) override {
+        if (pose.header.source_id >= kPoseShmSources) return false;
+        PoseShmSource* src = Source(pose.header.source_id);
+        size_t per_person = size_t(pose.header.keypoint_count) * pose.header.components;
+        uint32_t count = pose.header.person_count > 0 ? (uint32_t)std::min<size_t>({ per_person, pose.keypoints.size(), kPoseShmMaxFloats }) : 0;
+
+        uint64_t seq = src->seq.load(std::memory_order_relaxed);
+        src->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        src->recv_us = pose.recv_us;
+        src->header = pose.header;
+        src->header.person_count = count > 0 ? 1 : 0;
+        src->float_count = count;
+        if (count) std::memcpy(src->keypoints, pose.keypoints.data(), count * sizeof(float));
+        src->seq.store(seq + 2, std::memory_order_release);
+        static_cast<PoseShmHeader*>(region_.Data())->write_count.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    PoseShmSource* Source(uint32_t i) const { return reinterpret_cast<PoseShmSource*>(static_cast<uint8_t*>(region_.Data()) + sizeof(PoseShmHeader)) + i; }
+
+    ShmRegion region_;
+};
+
+#ifdef POSEBRIDGE_HAS_ROS2
+// PointCloud2 of every keypoint (x, y, z, visibility) on `target`, plus one TF
+// frame per keypoint of the first person under "posebridge_cam<N>".
+// Stamps are the capture wall clock, which is what RCL_SYSTEM_TIME uses.
+class Ros2PoseSink : public PoseSink {
+public:
+    ~Ros2PoseSink() override {
+        tf_.reset();
+        pub_.reset();
+        node_.reset();
+        if (owns_init_) rclcpp::shutdown();
+    }
+
+    bool Open(const std::string& target, std::string& error) override {
+        try {
+            if (!rclcpp::ok()) { rclcpp::init(0, nullptr); owns_init_ = true; }
+            node_ = std::make_shared<rclcpp::Node>("posebridge");
+            pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud2>(target, rclcpp::SensorDataQoS());
+            tf_ = std::make_unique<tf2_ros::TransformBroadcaster>(*node_);
+        }
+        catch (const std::exception& e) { error = e.what(); return false; }
+        return true;
+    }
+
+    bool Send(const PoseSample& pose) override {
+        const PoseHeader& h = pose.header;
+        if (h.components < 3) return false;
+        size_t n = std::min(size_t(h.person_count) * h.keypoint_count, pose.keypoints.size() / h.components);
+        sensor_msgs::msg::PointCloud2 cloud;
+        cloud.header.stamp = rclcpp::Time(h.capture_us * 1000, RCL_SYSTEM_TIME);
+        cloud.header.frame_id = "posebridge_cam" + std::to_string(h.source_id);
+        sensor_msgs::PointCloud2Modifier mod(cloud);
+        mod.setPointCloud2Fields(4,
+            "x", 1, sensor_msgs::msg::PointField::FLOAT32, "y", 1, sensor_msgs::msg::PointField::FLOAT32,
+            "z", 1, sensor_msgs::msg::PointField::FLOAT32, "visibility", 1, sensor_msgs::msg::PointField::FLOAT32);
+        mod.resize(n);
+        sensor_msgs::PointCloud2Iterator<float> x(cloud, "x"), y(cloud, "y"), z(cloud, "z"), v(cloud, "visibility");
+        transforms_.clear();
+        for (size_t i = 0; i < n; ++i, ++x, ++y, ++z, ++v) {
+            const float* p = pose.keypoints.data() + i * h.components;
+            *x = p[0]; *y = p[1]; *z = p[2]; *v = h.components >= 4 ? p[3] : 1.0f;
+            if (i >= h.keypoint_count) continue;
+            geometry_msgs::msg::TransformStamped t;
+            t.header = cloud.header;
+            t.child_frame_id = cloud.header.frame_id + "/kp" + std::to_string(i);
+            t.transform.translation.x = p[0]; t.transform.translation.y = p[1]; t.transform.translation.z = p[2];
+            t.transform.rotation.w = 1.0;
+            transforms_.push_back(std::move(t));
+        }
+        pub_->publish(cloud);
+        if (!transforms_.empty()) tf_->sendTransform(transforms_);
+        return true;
+    }
+
+private:
+    bool owns_init_ = false;
+    rclcpp::Node::SharedPtr node_;
+    rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr pub_;
+    std::unique_ptr<tf2_ros::TransformBroadcaster> tf_;
+    std::vector<geometry_msgs::msg::TransformStamped> transforms_;
+};
+#endif
+
+bool PoseSinkAvailable(PoseSinkKind kind) {
+    switch (kind) {
+    case SINK_OPENVR:
+    case SINK_VMC:
+    case SINK_UDP:
+    case SINK_COMPACT: return true;
+#ifdef POSEBRIDGE_HAS_ROS2
+    case SINK_ROS2: return true;
+#endif
+    default: return false;
+    }
+}
+
+std::unique_ptr<PoseSink> CreatePoseSink(PoseSinkKind kind) {
+    switch (kind) {
+    case SINK_OPENVR: return std::make_unique<OpenVrShmSink>();
+#ifdef POSEBRIDGE_HAS_ROS2
+    case SINK_ROS2: return std::make_unique<Ros2PoseSink>();
+#endif
+    case SINK_VMC: return std::make_unique<VmcPoseSink>();
+    case SINK_UDP: return std::make_unique<UdpPoseSink>();
+    case SINK_COMPACT: return std::make_unique<CompactPoseSink>();
+    default: return nullptr;
+    }
+}
+
+// --- Hub ---
+
+void PoseOutputHub::SetTarget(PoseSinkKind kind, const std::string& target) {
+    std::lock_guard<std::mutex> lock(slots_[kind].target_mutex);
+    slots_[kind].target = target;
+}
+
+std::string PoseOutputHub::Target(PoseSinkKind kind) const {
+    std::lock_guard<std::mutex> lock(slots_[kind].target_mutex);
+    return slots_[kind].target.empty() ? kPoseSinkDefaultTargets[kind] : slots_[kind].target;
+}
+
+void PoseOutputHub::Publish(const PoseHeader& header, const float* keypoints, size_t count, int64_t recv_us) {
+    bool any = false;
+    for (const Slot& s : slots_) any = any || s.active;
+    if (!any) return;
+    auto sample = std::make_shared<PoseSample>();
+    sample->header = header;
+    sample->keypoints.assign(keypoints, keypoints + count);
+    sample->recv_us = recv_us;
+    std::shared_ptr<const PoseSample> shared = std::move(sample);
+    for (Slot& s : slots_) if (s.active) s.queue.Push(shared);
+}
+
+void PoseOutputHub::Worker(PoseSinkKind kind, std::string target) {
+    Slot& slot = slots_[kind];
+    std::unique_ptr<PoseSink> sink = CreatePoseSink(kind);
+    std::string error = "not built in";
+    if (!sink || !sink->Open(target, error)) {
+        app.Log("[ERR] Output " + std::string(kPoseSinkNames[kind]) + " (" + target + "): " + error);
+        slot.failed = true;
+        return;
+    }
+    app.Log("[SYS] Output " + std::string(kPoseSinkNames[kind]) + " -> " + target);
+    slot.active = true;
+    std::shared_ptr<const PoseSample> pose;
+    PoseSample predicted;
+    ThreadTuner tuner(ROLE_OUTPUT);
+    while (!slot.stop) {
+        tuner.Poll();
+        if (!slot.queue.Pop(pose, std::chrono::milliseconds(100))) continue;
+        // With filtering on, send the source's pose as of now rather than as of capture
+        const PoseSample* out = pose.get();
+        if (app.pose_filters.enabled && app.pose_filters.Predict(pose->header.source_id, WallClockMicros() + app.pose_filters.lead_us, predicted)) {
+            predicted.recv_us = pose->recv_us;
+            out = &predicted;
+        }
+        if (sink->Send(*out)) slot.sent++;
+        else slot.errors++;
+    }
+    slot.active = false;
+}
+
+void PoseOutputHub::StopWorker(Slot& slot) {
+    slot.stop = true;
+    if (slot.worker.joinable()) slot.worker.join();
+    slot.active = false;
+    slot.failed = false;
+    slot.queue.Clear();
+}
+
+void PoseOutputHub::Run() {
+    while (app.is_running) {
+        for (int k = 0; k < SINK_COUNT; k++) {
+            Slot& s = slots_[k];
+            std::string target = Target(PoseSinkKind(k));
+            bool want = s.enabled && PoseSinkAvailable(PoseSinkKind(k));
+            if (s.worker.joinable() && (!want || target != s.running_target)) StopWorker(s);
+            // A sink that failed to open stays down until it is toggled or retargeted
+            if (!want || s.worker.joinable()) continue;
+            s.stop = false;
+            s.running_target = target;
+            s.worker = std::thread(&PoseOutputHub::Worker, this, PoseSinkKind(k), target);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    for (Slot& s : slots_) StopWorker(s);
+}
+
+void PoseOutputThread() {
+    app.outputs.Run();
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pose_format.h"
+#include "stage_queue.h"
+
+// Fan-out of every received pose to external consumers. ReceiverThread hands
+// each pose over once; every enabled sink then runs on its own thread behind a
+// small drop-oldest queue, so a slow or stalled consumer only loses its own
+// oldest poses and never holds up pose reception.
+
+enum PoseSinkKind {
+    SINK_OPENVR = 0, // shared-memory block read by a SteamVR tracker driver
+    SINK_ROS2,       // sensor_msgs/PointCloud2 + TF per keypoint
+    SINK_VMC,        // OSC / Virtual Motion Capture tracker messages
+    SINK_UDP,        // raw pose packets, same bytes as the pose channel
+    SINK_COMPACT,    // UDP, quantized keyframe + delta packets (pose_codec.h)
+    SINK_COUNT
+};
+
+extern const char* kPoseSinkNames[SINK_COUNT];
+extern const char* kPoseSinkDefaultTargets[SINK_COUNT];
+
+// Shared-memory layout for SINK_OPENVR (little-endian, for the driver side):
+//   [PoseShmHeader][PoseShmSource 0]...[PoseShmSource source_count-1]
+// Each source is a seqlock: `seq` is odd while the writer is inside, so a
+// reader copies the source, then re-reads `seq` and retries if it changed or is odd.
+constexpr uint32_t kPoseShmMagic = 0x56534250; // "PBSV"
+constexpr uint32_t kPoseShmVersion = 1;
+constexpr uint32_t kPoseShmSources = 8;
+constexpr uint32_t kPoseShmMaxFloats = 33 * 4; // first person only, up to 33 keypoints x (x, y, z, v)
+
+struct alignas(64) PoseShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t source_count;
+    uint32_t max_floats;
+    std::atomic<uint64_t> write_count; // poses written, across all sources
+    uint8_t reserved[40];
+};
+
+struct alignas(64) PoseShmSource {
+    std::atomic<uint64_t> seq;
+    int64_t recv_us;    // wall clock when the bridge received it
+    PoseHeader header;  // person_count is 0 or 1 here
+    uint32_t float_count;
+    float keypoints[kPoseShmMaxFloats];
+};
+
+static_assert(sizeof(PoseShmHeader) == 64, "PoseShmHeader layout is shared with the tracker driver");
+
+struct PoseSample {
+    PoseHeader header{};
+    std::vector<float> keypoints;
+    int64_t recv_us = 0;
+};
+
+class PoseSink {
+public:
+    virtual ~PoseSink() = default;
+    // `target` is sink specific: shm name, ROS topic, or host:port
+    virtual bool Open(const std::string& target, std::string& error) = 0;
+    virtual bool Send(const PoseSample& pose) = 0;
+};
+
+bool PoseSinkAvailable(PoseSinkKind kind);
+std::unique_ptr<PoseSink> CreatePoseSink(PoseSinkKind kind);
+
+class PoseOutputHub {
+public:
+    static constexpr size_t kQueueDepth = 4;
+
+    void SetEnabled(PoseSinkKind kind, bool on) { slots_[kind].enabled = on; }
+    bool Enabled(PoseSinkKind kind) const { return slots_[kind].enabled; }
+    // Takes effect by restarting the sink if it is running
+    void SetTarget(PoseSinkKind kind, const std::string& target);
+    std::string Target(PoseSinkKind kind) const;
+
+    // Called by ReceiverThread. Copies the pose once and queues it for every open sink.
+    void Publish(const PoseHeader& header, const float* keypoints, size_t count, int64_t recv_us);
+
+    bool Active(PoseSinkKind kind) const { return slots_[kind].active; }
+    uint64_t Sent(PoseSinkKind kind) const { return slots_[kind].sent; }
+    uint64_t Dropped(PoseSinkKind kind) const { return slots_[kind].queue.Dropped(); }
+    uint64_t Errors(PoseSinkKind kind) const { return slots_[kind].errors; }
+    bool Failed(PoseSinkKind kind) const { return slots_[kind].failed; }
+
+    // Starts and stops sink threads to match the settings, until app.is_running clears
+    void Run();
+
+private:
+    struct Slot {
+        std::atomic<bool> enabled{ false };
+        mutable std::mutex target_mutex;
+        std::string target;
+        // Worker side
+        StageQueue<std::shared_ptr<const PoseSample>> queue{ kQueueDepth };
+        std::thread worker;
+        std::string running_target; // target the worker was started with
+        std::atomic<bool> stop{ false };
+        std::atomic<bool> active{ false }; // sink is open and taking poses
+        std::atomic<bool> failed{ false }; // Open failed; not retried until the target changes
+        std::atomic<uint64_t> sent{ 0 };
+        std::atomic<uint64_t> errors{ 0 };
+    };
+
+    void Worker(PoseSinkKind kind, std::string target);
+    void StopWorker(Slot& slot);
+
+    Slot slots_[SINK_COUNT];
+};
+
+// Runs app.outputs.Run(); started next to CameraThread and ReceiverThread
+void PoseOutputThread();
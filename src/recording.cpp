@@ -0,0 +1,204 @@
+#include "recording.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "clock.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t Padded(size_t n) { return (n + 7) & ~size_t(7); }
+
+bool Recorder::Open(const std::string& path) {
+    Close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+    RecordingHeader h{};
+    h.magic = kRecordingMagic;
+    h.version = kRecordingVersion;
+    h.start_us = WallClockMicros();
+    if (std::fwrite(&h, sizeof(h), 1, file_) != 1) { std::fclose(file_); file_ = nullptr; return false; }
+    path_ = path;
+    index_.clear();
+    records_ = 0;
+    bytes_ = sizeof(h);
+    active_ = true;
+    return true;
+}
+
+void Recorder::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_ = false;
+    if (!file_) return;
+    RecordingTrailer t{};
+    t.index_offset = bytes_;
+    t.index_count = index_.size();
+    t.magic = kRecordingTrailerMagic;
+    if (!index_.empty()) std::fwrite(index_.data(), sizeof(RecordIndexEntry), index_.size(), file_);
+    std::fwrite(&t, sizeof(t), 1, file_);
+    std::fclose(file_);
+    file_ = nullptr;
+    index_.clear();
+}
+
+std::string Recorder::Path() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ ? path_ : std::string();
+}
+
+void Recorder::AddFrame(int source_id, uint64_t frame_id, std::string_view meta, RecordFormat format, const void* data, size_t size, int width, int height) {
+    if (!Active()) return;
+    RecordHeader h{};
+    h.kind = RECORD_FRAME;
+    h.format = format;
+    h.source_id = (uint16_t)source_id;
+    h.frame_id = frame_id;
+    h.width = (uint32_t)width;
+    h.height = (uint32_t)height;
+    Append(h, meta, data, size, nullptr, 0);
+}
+
+void Recorder::AddPose(const PoseHeader& pose, const float* keypoints, size_t count) {
+    if (!Active()) return;
+    // Re-stamped as a current-version packet: the keypoints follow the header directly
+    PoseHeader packet = pose;
+    packet.magic = kPoseMagic;
+    packet.version = kPoseVersion;
+    packet.header_size = sizeof(PoseHeader);
+    RecordHeader h{};
+    h.kind = RECORD_POSE;
+    h.format = RECORD_POSE_PACKET;
+    h.source_id = pose.source_id;
+    h.frame_id = pose.frame_id;
+    Append(h, {}, &packet, sizeof(packet), keypoints, count * sizeof(float));
+}
+
+void Recorder::Append(RecordHeader h, std::string_view meta, const void* a, size_t a_size, const void* b, size_t b_size) {
+    static const uint8_t kZeros[8] = {};
+    h.magic = kRecordMagic;
+    h.meta_size = (uint32_t)meta.size();
+    h.payload_size = (uint32_t)(a_size + b_size);
+    h.t_us = WallClockMicros();
+    size_t body = sizeof(h) + meta.size() + a_size + b_size;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_) return;
+    RecordIndexEntry e{ bytes_, h.t_us, h.kind, h.format, h.source_id, 0 };
+    bool ok = std::fwrite(&h, sizeof(h), 1, file_) == 1;
+    if (ok && !meta.empty()) ok = std::fwrite(meta.data(), meta.size(), 1, file_) == 1;
+    if (ok && a_size) ok = std::fwrite(a, a_size, 1, file_) == 1;
+    if (ok && b_size) ok = std::fwrite(b, b_size, 1, file_) == 1;
+    if (ok && Padded(body) != body) ok = std::fwrite(kZeros, Padded(body) - body, 1, file_) == 1;
+    // A full disk ends the recording; what was written so far stays readable
+    if (!ok) { std::fclose(file_); file_ = nullptr; active_ = false; return; }
+    index_.push_back(e);
+    bytes_ += Padded(body);
+    records_++;
+}
+
+bool RecordingReader::Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(RecordingHeader)) { CloseHandle(file); return false; }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) { CloseHandle(file); return false; }
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) { CloseHandle(mapping); CloseHandle(file); return false; }
+    file_ = file;
+    mapping_ = mapping;
+    size_ = (size_t)size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(RecordingHeader)) { close(fd); return false; }
+    void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) { close(fd); return false; }
+    // Replay walks the file front to back
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+    fd_ = fd;
+    size_ = (size_t)st.st_size;
+#endif
+    base_ = static_cast<const uint8_t*>(base);
+    path_ = path;
+    const RecordingHeader* h = reinterpret_cast<const RecordingHeader*>(base_);
+    if (h->magic != kRecordingMagic || h->version != kRecordingVersion) { Close(); return false; }
+
+    RecordingTrailer t{};
+    if (size_ >= sizeof(RecordingHeader) + sizeof(t)) std::memcpy(&t, base_ + size_ - sizeof(t), sizeof(t));
+    if (t.magic == kRecordingTrailerMagic && t.index_offset >= sizeof(RecordingHeader) && t.index_offset % 8 == 0 &&
+        t.index_offset + t.index_count * sizeof(RecordIndexEntry) + sizeof(t) == size_) {
+        index_ = reinterpret_cast<const RecordIndexEntry*>(base_ + t.index_offset);
+        count_ = (size_t)t.index_count;
+        return true;
+    }
+    recovered_ = true;
+    return Rebuild();
+}
+
+bool RecordingReader::Rebuild() {
+    rebuilt_.clear();
+    size_t off = sizeof(RecordingHeader);
+    while (off + sizeof(RecordHeader) <= size_) {
+        const RecordHeader* h = reinterpret_cast<const RecordHeader*>(base_ + off);
+        size_t body = Padded(sizeof(RecordHeader) + size_t(h->meta_size) + h->payload_size);
+        if (h->magic != kRecordMagic || off + body > size_) break;
+        rebuilt_.push_back(RecordIndexEntry{ off, h->t_us, h->kind, h->format, h->source_id, 0 });
+        off += body;
+    }
+    index_ = rebuilt_.data();
+    count_ = rebuilt_.size();
+    return true;
+}
+
+void RecordingReader::Close() {
+    if (base_) {
+#ifdef _WIN32
+        UnmapViewOfFile(base_);
+        CloseHandle((HANDLE)mapping_);
+        CloseHandle((HANDLE)file_);
+        mapping_ = file_ = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(base_), size_);
+        close(fd_);
+        fd_ = -1;
+#endif
+    }
+    base_ = nullptr;
+    size_ = 0;
+    index_ = nullptr;
+    count_ = 0;
+    rebuilt_.clear();
+    recovered_ = false;
+}
+
+bool RecordingReader::Get(size_t i, Record& out) const {
+    if (i >= count_) return false;
+    uint64_t off = index_[i].offset;
+    if (off + sizeof(RecordHeader) > size_) return false;
+    const RecordHeader* h = reinterpret_cast<const RecordHeader*>(base_ + off);
+    if (h->magic != kRecordMagic || off + sizeof(RecordHeader) + h->meta_size + h->payload_size > size_) return false;
+    out.header = h;
+    out.meta = std::string_view(reinterpret_cast<const char*>(h + 1), h->meta_size);
+    out.payload = reinterpret_cast<const uint8_t*>(h + 1) + h->meta_size;
+    return true;
+}
+
+std::vector<int> RecordingReader::FrameSources() const {
+    std::vector<int> out;
+    for (size_t i = 0; i < count_; i++)
+        if (index_[i].kind == RECORD_FRAME && std::find(out.begin(), out.end(), index_[i].source_id) == out.end()) out.push_back(index_[i].source_id);
+    std::sort(out.begin(), out.end());
+    return out;
+}
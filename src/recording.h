@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pose_format.h"
+
+// Append-only recording of the published frames and the received poses,
+// memory-mapped whole for replay. Little-endian, fixed layout:
+//   RecordingHeader
+//   records: RecordHeader, meta bytes, payload bytes, zero padding to 8
+//   RecordIndexEntry[index_count]   written by Close
+//   RecordingTrailer
+// A file whose writer died has no trailer; the reader then walks the records
+// from the start to rebuild the index, stopping at the first torn one.
+
+constexpr uint32_t kRecordingMagic = 0x46524250;  // "PBRF"
+constexpr uint32_t kRecordMagic = 0x52524250;     // "PBRR"
+constexpr uint32_t kRecordingTrailerMagic = 0x58524250; // "PBRX"
+constexpr uint32_t kRecordingVersion = 1;
+
+enum RecordKind : uint8_t {
+    RECORD_FRAME = 0, // what PublishThread sent on the frame socket
+    RECORD_POSE = 1   // what ReceiverThread got back
+};
+
+enum RecordFormat : uint8_t {
+    RECORD_JPEG = 0,        // compressed payload as published, never re-encoded
+    RECORD_BGR24 = 1,       // shm transport: rows packed tightly, width * height * 3 bytes
+    RECORD_POSE_PACKET = 2  // PoseHeader + float32 block (pose_format.h)
+};
+
+struct RecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t start_us;     // wall clock at Open
+    uint8_t reserved[48];
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    uint8_t kind;           // RecordKind
+    uint8_t format;         // RecordFormat
+    uint16_t source_id;
+    uint32_t meta_size;     // frame meta JSON as published; 0 for poses
+    uint32_t payload_size;
+    int64_t t_us;           // wall clock when it was recorded
+    uint64_t frame_id;
+    uint32_t width, height; // frames; 0 for poses
+};
+
+struct RecordIndexEntry {
+    uint64_t offset;        // of the RecordHeader, from the start of the file
+    int64_t t_us;
+    uint8_t kind;
+    uint8_t format;
+    uint16_t source_id;
+    uint32_t reserved;
+};
+
+struct RecordingTrailer {
+    uint64_t index_offset;
+    uint64_t index_count;
+    uint32_t magic;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(RecordingHeader) == 64, "RecordingHeader is a file format");
+static_assert(sizeof(RecordHeader) == 40, "RecordHeader is a file format");
+static_assert(sizeof(RecordIndexEntry) == 24, "RecordIndexEntry is a file format");
+static_assert(sizeof(RecordingTrailer) == 24, "RecordingTrailer is a file format");
+
+// Writer side; safe from any thread. Appends are buffered stdio writes under a
+// mutex, so a stream that is not being recorded pays one relaxed load.
+class Recorder {
+public:
+    Recorder() = default;
+    ~Recorder() { Close(); }
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Starts a new file at `path`, closing the current one first
+    bool Open(const std::string& path);
+    // Writes the index and trailer; the file is complete after this
+    void Close();
+    bool Active() const { return active_.load(std::memory_order_relaxed); }
+    std::string Path();
+    uint64_t Records() const { return records_; }
+    uint64_t Bytes() const { return bytes_; }
+
+    void AddFrame(int source_id, uint64_t frame_id, std::string_view meta, RecordFormat format, const void* data, size_t size, int width, int height);
+    void AddPose(const PoseHeader& h, const float* keypoints, size_t count);
+
+private:
+    void Append(RecordHeader h, std::string_view meta, const void* a, size_t a_size, const void* b, size_t b_size);
+
+    std::mutex mutex_;
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    std::vector<RecordIndexEntry> index_;
+    std::atomic<bool> active_{ false };
+    std::atomic<uint64_t> records_{ 0 };
+    std::atomic<uint64_t> bytes_{ 0 };
+};
+
+// Read side: maps a finished (or torn) recording read-only. Records point
+// straight into the mapping and stay valid until Close.
+class RecordingReader {
+public:
+    struct Record {
+        const RecordHeader* header = nullptr;
+        std::string_view meta;
+        const uint8_t* payload = nullptr;
+    };
+
+    RecordingReader() = default;
+    ~RecordingReader() { Close(); }
+    RecordingReader(const RecordingReader&) = delete;
+    RecordingReader& operator=(const RecordingReader&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return base_ != nullptr; }
+    const std::string& Path() const { return path_; }
+    // True if the file had no trailer and its index was rebuilt by scanning
+    bool Recovered() const { return recovered_; }
+
+    size_t Count() const { return count_; }
+    const RecordIndexEntry& Entry(size_t i) const { return index_[i]; }
+    bool Get(size_t i, Record& out) const;
+    int64_t FirstUs() const { return count_ ? index_[0].t_us : 0; }
+    int64_t LastUs() const { return count_ ? index_[count_ - 1].t_us : 0; }
+    // Sorted source ids that have at least one frame
+    std::vector<int> FrameSources() const;
+
+private:
+    bool Rebuild();
+
+    std::string path_;
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    const RecordIndexEntry* index_ = nullptr; // into the mapping, or rebuilt_
+    size_t count_ = 0;
+    std::vector<RecordIndexEntry> rebuilt_;
+    bool recovered_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
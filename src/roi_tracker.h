@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+// Person-following crop for one source. The pose stream reports where the
+// person was (Observe), and the capture worker ships only a padded region
+// around it (Next) instead of the whole sensor image. Every keyframe_interval
+// frames, and whenever the person is lost, a full frame goes out instead so
+// the engine can find someone new.
+struct RoiSettings {
+    std::atomic<bool> enabled{ false };
+    std::atomic<float> padding{ 0.25f };        // margin around the person box, relative to its larger side
+    std::atomic<int> keyframe_interval{ 30 };   // frames between full-frame keyframes, 0 = never
+    std::atomic<int> min_size{ 128 };           // crop side floor in sensor pixels
+};
+
+class RoiTracker {
+public:
+    // ReceiverThread: the person box of the newest pose of this source, in
+    // full-frame pixels; an empty box means nobody was found.
+    void Observe(const cv::Rect& box) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        box_ = box;
+        poses_since_box_ = 0;
+    }
+
+    // Capture worker: region of a `full` sized frame to ship next. Returns the
+    // whole frame on keyframes, when there is no recent box, or when disabled.
+    cv::Rect Next(cv::Size full, const RoiSettings& settings) {
+        cv::Rect whole(0, 0, full.width, full.height);
+        std::lock_guard<std::mutex> lock(mutex_);
+        int interval = settings.keyframe_interval;
+        // A box no pose has confirmed for a whole keyframe interval is stale
+        bool stale = interval > 0 && ++poses_since_box_ > interval;
+        if (!settings.enabled || box_.empty() || stale || (interval > 0 && ++since_keyframe_ >= interval)) {
+            since_keyframe_ = 0;
+            crop_ = whole;
+            return whole;
+        }
+        int side = std::max(box_.width, box_.height);
+        int pad = (int)(side * settings.padding);
+        cv::Rect want(box_.x - pad, box_.y - pad, box_.width + 2 * pad, box_.height + 2 * pad);
+        int min_size = std::min({ (int)settings.min_size, full.width, full.height });
+        if (want.width < min_size) { want.x -= (min_size - want.width) / 2; want.width = min_size; }
+        if (want.height < min_size) { want.y -= (min_size - want.height) / 2; want.height = min_size; }
+        want &= whole;
+        // Hold the previous crop while the person stays inside it and it is not
+        // much larger, so the engine sees a steady view instead of one that moves every frame
+        bool contains = (want & crop_) == want;
+        if (!contains || crop_.area() > 2 * want.area()) crop_ = Align(want, full);
+        return crop_;
+    }
+
+private:
+    // Even origin and 16-pixel multiples (JPEG MCUs), grown into the frame
+    static cv::Rect Align(cv::Rect r, cv::Size full) {
+        int x0 = r.x & ~1, y0 = r.y & ~1;
+        int w = std::min((r.x + r.width - x0 + 15) & ~15, full.width);
+        int h = std::min((r.y + r.height - y0 + 15) & ~15, full.height);
+        x0 = std::max(0, std::min(x0, full.width - w));
+        y0 = std::max(0, std::min(y0, full.height - h));
+        return cv::Rect(x0, y0, w, h);
+    }
+
+    std::mutex mutex_;
+    cv::Rect box_;
+    cv::Rect crop_;
+    int since_keyframe_ = 0;
+    int poses_since_box_ = 0; // frames shipped since the last Observe
+};
+
+// Bounding box of the keypoints of the first person with visibility >= `min_visibility`,
+// for a pose in POSE_LAYOUT_IMAGE_XYZV normalized to a `full` sized frame
+inline cv::Rect KeypointBox(const float* keypoints, int keypoint_count, int components, cv::Size full, float min_visibility) {
+    float x0 = 1.0f, y0 = 1.0f, x1 = 0.0f, y1 = 0.0f;
+    for (int k = 0; k < keypoint_count; k++) {
+        const float* p = keypoints + size_t(k) * components;
+        if (components >= 4 && p[3] < min_visibility) continue;
+        x0 = std::min(x0, p[0]); y0 = std::min(y0, p[1]);
+        x1 = std::max(x1, p[0]); y1 = std::max(y1, p[1]);
+    }
+    if (x1 <= x0 || y1 <= y0) return cv::Rect();
+    cv::Rect box((int)(std::max(0.0f, x0) * full.width), (int)(std::max(0.0f, y0) * full.height), 0, 0);
+    box.width = (int)(std::min(1.0f, x1) * full.width) - box.x;
+    box.height = (int)(std::min(1.0f, y1) * full.height) - box.y;
+    return box;
+}
@@ -0,0 +1,98 @@
+#include "shm_ring.h"
+
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool ShmRegion::Create(const std::string& name, size_t size) {
+    Close();
+    if (size == 0) return false;
+#ifdef _WIN32
+    HANDLE h = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), name.c_str());
+    if (!h) return false;
+    void* base = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!base) { CloseHandle(h); return false; }
+    mapping_ = h;
+#else
+    std::string shm_name = "/" + name;
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return false;
+    if (ftruncate(fd, (off_t)size) != 0) { close(fd); shm_unlink(shm_name.c_str()); return false; }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) { close(fd); shm_unlink(shm_name.c_str()); return false; }
+    fd_ = fd;
+#endif
+    base_ = base;
+    size_ = size;
+    name_ = name;
+    std::memset(base_, 0, size_);
+    return true;
+}
+
+void ShmRegion::Close() {
+    if (!base_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle((HANDLE)mapping_);
+    mapping_ = nullptr;
+#else
+    munmap(base_, size_);
+    close(fd_);
+    shm_unlink(("/" + name_).c_str());
+    fd_ = -1;
+#endif
+    base_ = nullptr;
+    size_ = 0;
+    name_.clear();
+}
+
+bool ShmFrameRing::Create(const std::string& name, uint32_t slot_count, uint32_t max_frame_bytes) {
+    Close();
+    if (slot_count == 0 || max_frame_bytes == 0) return false;
+    uint32_t stride = (uint32_t)((sizeof(ShmSlotHeader) + max_frame_bytes + 63) & ~size_t(63));
+    if (!region_.Create(name, sizeof(ShmRingHeader) + size_t(stride) * slot_count)) return false;
+
+    ShmRingHeader* hdr = new (region_.Data()) ShmRingHeader();
+    hdr->magic = kShmRingMagic;
+    hdr->version = kShmRingVersion;
+    hdr->slot_count = slot_count;
+    hdr->slot_stride = stride;
+    hdr->max_frame_bytes = max_frame_bytes;
+    hdr->write_seq.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; i++) new (Slot(i)) ShmSlotHeader();
+    return true;
+}
+
+int ShmFrameRing::Write(const cv::Mat& frame, uint64_t seq) {
+    if (!IsOpen() || frame.empty() || frame.depth() != CV_8U) return -1;
+    ShmRingHeader* hdr = Header();
+    size_t row_bytes = frame.cols * frame.elemSize();
+    size_t bytes = row_bytes * frame.rows;
+    if (bytes > hdr->max_frame_bytes) return -1;
+
+    uint32_t idx = (uint32_t)(seq % hdr->slot_count);
+    uint8_t* slot = Slot(idx);
+    ShmSlotHeader* sh = reinterpret_cast<ShmSlotHeader*>(slot);
+    uint8_t* pixels = slot + sizeof(ShmSlotHeader);
+
+    sh->seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (frame.isContinuous()) std::memcpy(pixels, frame.data, bytes);
+    else for (int y = 0; y < frame.rows; y++) std::memcpy(pixels + y * row_bytes, frame.ptr(y), row_bytes);
+    sh->width = frame.cols;
+    sh->height = frame.rows;
+    sh->step = (uint32_t)row_bytes;
+    sh->channels = frame.channels();
+    sh->data_bytes = (uint32_t)bytes;
+    sh->seq.store(seq, std::memory_order_release);
+    hdr->write_seq.store(seq, std::memory_order_release);
+    return (int)idx;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+// Shared-memory ring of raw BGR frames for an engine running on the same host.
+// Layout (little-endian, mirrored in scripts/engine.py):
+//   [ShmRingHeader][slot 0][slot 1]...[slot N-1]
+//   slot = [ShmSlotHeader][pixel rows, `step` bytes each]
+// A slot's `seq` is zeroed while it is being written and set to the frame
+// sequence once the pixels are complete, so a reader copies the pixels and then
+// re-checks `seq` to detect that the writer lapped it.
+
+constexpr uint32_t kShmRingMagic = 0x52534250; // "PBSR"
+constexpr uint32_t kShmRingVersion = 1;
+
+struct alignas(64) ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_stride;      // bytes from one slot header to the next
+    uint32_t max_frame_bytes;  // pixel capacity of a slot
+    uint32_t reserved[3];
+    std::atomic<uint64_t> write_seq; // sequence of the last completed slot
+};
+
+struct alignas(64) ShmSlotHeader {
+    std::atomic<uint64_t> seq;
+    uint32_t width;
+    uint32_t height;
+    uint32_t step;
+    uint32_t channels;
+    uint32_t data_bytes;
+};
+
+static_assert(sizeof(ShmRingHeader) == 64, "ShmRingHeader layout is shared with engine.py");
+static_assert(sizeof(ShmSlotHeader) == 64, "ShmSlotHeader layout is shared with engine.py");
+
+// A named, zero-filled block of shared memory; the name is unlinked again on Close
+class ShmRegion {
+public:
+    ShmRegion() = default;
+    ~ShmRegion() { Close(); }
+    ShmRegion(const ShmRegion&) = delete;
+    ShmRegion& operator=(const ShmRegion&) = delete;
+
+    bool Create(const std::string& name, size_t size);
+    void Close();
+    void* Data() const { return base_; }
+    size_t Size() const { return size_; }
+    const std::string& Name() const { return name_; }
+
+private:
+    std::string name_;
+    void* base_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+class ShmFrameRing {
+public:
+    ShmFrameRing() = default;
+    ~ShmFrameRing() { Close(); }
+    ShmFrameRing(const ShmFrameRing&) = delete;
+    ShmFrameRing& operator=(const ShmFrameRing&) = delete;
+
+    bool Create(const std::string& name, uint32_t slot_count, uint32_t max_frame_bytes);
+    void Close() { region_.Close(); }
+    bool IsOpen() const { return region_.Data() != nullptr; }
+    const std::string& Name() const { return region_.Name(); }
+
+    // Copies an 8-bit frame into the next slot (rows packed tightly). Returns the
+    // slot index, or -1 if the ring is closed or the frame exceeds the slot capacity.
+    int Write(const cv::Mat& frame, uint64_t seq);
+
+private:
+    ShmRingHeader* Header() const { return static_cast<ShmRingHeader*>(region_.Data()); }
+    uint8_t* Slot(uint32_t idx) const { return static_cast<uint8_t*>(region_.Data()) + sizeof(ShmRingHeader) + size_t(idx) * Header()->slot_stride; }
+
+    ShmRegion region_;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Bone lists for drawing a pose, picked by keypoint count
+struct SkeletonEdge { uint8_t a, b; };
+
+// MediaPipe / BlazePose, 33 keypoints (mp.solutions.pose.POSE_CONNECTIONS)
+constexpr SkeletonEdge kBlazePoseEdges[] = {
+    { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 7 }, { 0, 4 }, { 4, 5 }, { 5, 6 }, { 6, 8 }, { 9, 10 },
+    { 11, 12 }, { 11, 13 }, { 13, 15 }, { 15, 17 }, { 15, 19 }, { 15, 21 }, { 17, 19 },
+    { 12, 14 }, { 14, 16 }, { 16, 18 }, { 16, 20 }, { 16, 22 }, { 18, 20 },
+    { 11, 23 }, { 12, 24 }, { 23, 24 }, { 23, 25 }, { 24, 26 }, { 25, 27 }, { 26, 28 },
+    { 27, 29 }, { 28, 30 }, { 29, 31 }, { 30, 32 }, { 27, 31 }, { 28, 32 }
+};
+
+// COCO, 17 keypoints (RTMPose and most SimCC models)
+constexpr SkeletonEdge kCocoEdges[] = {
+    { 0, 1 }, { 0, 2 }, { 1, 3 }, { 2, 4 }, { 5, 6 }, { 5, 7 }, { 7, 9 }, { 6, 8 }, { 8, 10 },
+    { 5, 11 }, { 6, 12 }, { 11, 12 }, { 11, 13 }, { 13, 15 }, { 12, 14 }, { 14, 16 }
+};
+
+// Empty for layouts without a known skeleton; draw the points alone then
+inline const SkeletonEdge* SkeletonEdges(int keypoint_count, size_t& count) {
+    if (keypoint_count == 33) { count = sizeof(kBlazePoseEdges) / sizeof(kBlazePoseEdges[0]); return kBlazePoseEdges; }
+    if (keypoint_count == 17) { count = sizeof(kCocoEdges) / sizeof(kCocoEdges[0]); return kCocoEdges; }
+    count = 0;
+    return nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Bounded hand-off between two pipeline stages. A full queue drops its oldest
+// item, so a slow consumer only ever sees the most recent `capacity` items and
+// the producer never blocks. Items live in a fixed ring, so passing them along
+// never allocates.
+template <typename T>
+class StageQueue {
+public:
+    explicit StageQueue(size_t capacity) : items_(capacity ? capacity : 1) {}
+
+    // Returns false if an older item was dropped to make room.
+    bool Push(T item) {
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Overwriting the oldest releases it
+            if (count_ == items_.size()) { head_ = (head_ + 1) % items_.size(); count_--; dropped = true; dropped_++; }
+            items_[(head_ + count_) % items_.size()] = std::move(item);
+            count_++;
+        }
+        cv_.notify_one();
+        return !dropped;
+    }
+
+    // Waits up to `timeout` for an item. Returns false on timeout.
+    template <typename Rep, typename Period>
+    bool Pop(T& out, std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_for(lock, timeout, [this] { return count_ > 0; })) return false;
+        out = std::move(items_[head_]);
+        items_[head_] = T();
+        head_ = (head_ + 1) % items_.size();
+        count_--;
+        return true;
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (T& item : items_) item = T();
+        head_ = count_ = 0;
+    }
+    uint64_t Dropped() const { std::lock_guard<std::mutex> lock(mutex_); return dropped_; }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<T> items_;
+    size_t head_ = 0, count_ = 0;
+    uint64_t dropped_ = 0;
+};
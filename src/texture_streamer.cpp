@@ -0,0 +1,58 @@
+#include "texture_streamer.h"
+
+#include <cstring>
+
+void TextureStreamer::Allocate(int w, int h) {
+    Release();
+    size_t bytes = size_t(w) * h * 3;
+    glGenTextures(1, &tex_);
+    glBindTexture(GL_TEXTURE_2D, tex_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Immutable storage where available (GL 4.2 / ARB_texture_storage, not on macOS 3.2 core)
+    if (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage) glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB8, w, h);
+    else glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, w, h, 0, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glGenBuffers(2, pbos_);
+    for (GLuint pbo : pbos_) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    width_ = w;
+    height_ = h;
+}
+
+void TextureStreamer::Release() {
+    if (tex_) glDeleteTextures(1, &tex_);
+    if (pbos_[0]) glDeleteBuffers(2, pbos_);
+    tex_ = 0;
+    pbos_[0] = pbos_[1] = 0;
+    width_ = height_ = 0;
+    last_seq_ = 0;
+}
+
+bool TextureStreamer::Upload(const cv::Mat& frame, uint64_t seq) {
+    if (frame.empty() || frame.type() != CV_8UC3) return false;
+    if (tex_ && seq == last_seq_) return false;
+    if (frame.cols != width_ || frame.rows != height_) Allocate(frame.cols, frame.rows);
+
+    size_t row_bytes = size_t(width_) * 3;
+    size_t bytes = row_bytes * height_;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos_[pbo_index_]);
+    pbo_index_ ^= 1;
+    // Invalidating lets the driver hand back fresh memory instead of waiting on a DMA still in flight
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst) { glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); return false; }
+    if (frame.isContinuous()) std::memcpy(dst, frame.data, bytes);
+    else for (int y = 0; y < height_; y++) std::memcpy(static_cast<uint8_t*>(dst) + y * row_bytes, frame.ptr(y), row_bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_2D, tex_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    last_seq_ = seq;
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <opencv2/core.hpp>
+
+// Streams BGR frames into a persistent GL texture. Storage is allocated once
+// per frame size, pixels go through two alternating pixel-unpack buffers so
+// glTexSubImage2D returns while the DMA runs, and GL_BGR is uploaded directly so
+// no CPU swizzle is needed. Must be used and released on the GL thread.
+class TextureStreamer {
+public:
+    TextureStreamer() = default;
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Uploads a CV_8UC3 frame unless `seq` matches the last upload.
+    // Returns true if the texture changed.
+    bool Upload(const cv::Mat& frame, uint64_t seq);
+    void Release();
+
+    GLuint Texture() const { return tex_; }
+    int Width() const { return width_; }
+    int Height() const { return height_; }
+
+private:
+    void Allocate(int w, int h);
+
+    GLuint tex_ = 0;
+    GLuint pbos_[2] = { 0, 0 };
+    int pbo_index_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    uint64_t last_seq_ = 0;
+};
@@ -0,0 +1,162 @@
+#include "thread_tuning.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "app_state.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+const char* kThreadRoleNames[THREAD_ROLE_COUNT] = { "capture", "encode", "publish", "receiver", "inference", "output", "ui" };
+const char* kThreadPriorityNames[THREAD_PRIORITY_COUNT] = { "normal", "high", "realtime" };
+
+// SCHED_FIFO priorities: the grab preempts everything else of ours, the UI nothing
+static const int kRealtimePriority[THREAD_ROLE_COUNT] = { 60, 45, 50, 55, 40, 45, 20 };
+// Engine processes under SCHED_FIFO sit below every pipeline thread but the UI
+static const int kEngineRealtimePriority = 30;
+static const int kHighNice = -10;
+
+std::string FormatCpuList(const std::vector<int>& cpus) {
+    if (cpus.empty()) return "any";
+    std::string out;
+    for (size_t i = 0; i < cpus.size(); i++) out += (i ? "," : "") + std::to_string(cpus[i]);
+    return out;
+}
+
+#ifdef _WIN32
+// MMCSS registration of this thread while it runs at PRIORITY_REALTIME
+static thread_local HANDLE t_mmcss = nullptr;
+
+static void LeaveMmcss() {
+    if (t_mmcss) { AvRevertMmThreadCharacteristics(t_mmcss); t_mmcss = nullptr; }
+}
+
+// Affinity masks cover the first processor group only
+static bool CpuMask(const std::vector<int>& cpus, DWORD_PTR& mask, std::string& error) {
+    mask = 0;
+    for (int c : cpus) {
+        if (c >= (int)(sizeof(DWORD_PTR) * 8)) { error = "CPU " + std::to_string(c) + " is outside processor group 0"; return false; }
+        mask |= DWORD_PTR(1) << c;
+    }
+    return true;
+}
+
+bool ApplyThreadTuning(ThreadRole role, const ThreadTuning& t, std::string& error) {
+    bool ok = true;
+    DWORD_PTR mask, process_mask, system_mask;
+    if (!t.cpus.empty()) {
+        if (!CpuMask(t.cpus, mask, error)) ok = false;
+        else if (!SetThreadAffinityMask(GetCurrentThread(), mask)) { error = "SetThreadAffinityMask failed (" + std::to_string(GetLastError()) + ")"; ok = false; }
+    }
+    else if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) SetThreadAffinityMask(GetCurrentThread(), process_mask);
+
+    static const int kWinPriority[THREAD_PRIORITY_COUNT] = { THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL };
+    if (!SetThreadPriority(GetCurrentThread(), kWinPriority[t.priority])) { error = "SetThreadPriority failed (" + std::to_string(GetLastError()) + ")"; ok = false; }
+    if (t.priority != PRIORITY_REALTIME) LeaveMmcss();
+    else if (!t_mmcss) {
+        // MMCSS keeps the thread scheduled under load without a realtime process class
+        DWORD task = 0;
+        t_mmcss = AvSetMmThreadCharacteristicsW(role == ROLE_UI ? L"Games" : L"Capture", &task);
+        if (!t_mmcss) { error = "MMCSS registration failed (" + std::to_string(GetLastError()) + ")"; ok = false; }
+        else AvSetMmThreadPriority(t_mmcss, AVRT_PRIORITY_CRITICAL);
+    }
+    return ok;
+}
+
+bool ApplyProcessTuning(void* process, const ThreadTuning& t, std::string& error) {
+    bool ok = true;
+    DWORD_PTR mask;
+    if (!t.cpus.empty()) {
+        if (!CpuMask(t.cpus, mask, error)) ok = false;
+        else if (!SetProcessAffinityMask((HANDLE)process, mask)) { error = "SetProcessAffinityMask failed (" + std::to_string(GetLastError()) + ")"; ok = false; }
+    }
+    static const DWORD kClass[THREAD_PRIORITY_COUNT] = { NORMAL_PRIORITY_CLASS, HIGH_PRIORITY_CLASS, REALTIME_PRIORITY_CLASS };
+    // Without the privilege REALTIME silently becomes HIGH
+    if (t.priority != PRIORITY_NORMAL && !SetPriorityClass((HANDLE)process, kClass[t.priority])) { error = "SetPriorityClass failed (" + std::to_string(GetLastError()) + ")"; ok = false; }
+    return ok;
+}
+#else
+bool ApplyThreadTuning(ThreadRole role, const ThreadTuning& t, std::string& error) {
+    bool ok = true;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (t.cpus.empty()) for (int c = 0; c < CPU_SETSIZE; c++) CPU_SET(c, &set); // the kernel narrows this to the allowed CPUs
+    else for (int c : t.cpus) if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) { error = std::string("affinity: ") + std::strerror(rc); ok = false; }
+#else
+    if (!t.cpus.empty()) { error = "CPU affinity is not supported on this platform"; ok = false; }
+#endif
+    sched_param param{};
+    int policy = SCHED_OTHER;
+    if (t.priority == PRIORITY_REALTIME) { policy = SCHED_FIFO; param.sched_priority = kRealtimePriority[role]; }
+    int rc_sched = pthread_setschedparam(pthread_self(), policy, &param);
+    if (rc_sched != 0) { error = std::string("scheduler: ") + std::strerror(rc_sched); ok = false; }
+#ifdef __linux__
+    // Linux keeps a nice value per thread, addressed by its tid
+    if (t.priority != PRIORITY_REALTIME && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), t.priority == PRIORITY_HIGH ? kHighNice : 0) != 0) {
+        error = std::string("nice: ") + std::strerror(errno);
+        ok = false;
+    }
+#else
+    if (t.priority == PRIORITY_HIGH) { error = "high priority is not supported on this platform, use realtime"; ok = false; }
+#endif
+    return ok;
+}
+
+// Only write(2) here: the child has not exec'd yet. Lands in the engine log via the pipe.
+static void ChildError(const char* what) {
+    const char* why = errno == EPERM ? ": not permitted\n" : ": failed\n";
+    (void)!write(STDERR_FILENO, "[ERR] Engine tuning, ", 21);
+    (void)!write(STDERR_FILENO, what, strlen(what));
+    (void)!write(STDERR_FILENO, why, strlen(why));
+}
+
+void ApplyTuningBeforeExec(const ThreadTuning& t) {
+#ifdef __linux__
+    if (!t.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : t.cpus) if (c < CPU_SETSIZE) CPU_SET(c, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) ChildError("affinity");
+    }
+#endif
+    if (t.priority == PRIORITY_HIGH && setpriority(PRIO_PROCESS, 0, kHighNice) != 0) ChildError("nice");
+    if (t.priority == PRIORITY_REALTIME) {
+        sched_param param{};
+        param.sched_priority = kEngineRealtimePriority;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) ChildError("SCHED_FIFO");
+    }
+}
+#endif
+
+ThreadTuner::~ThreadTuner() {
+#ifdef _WIN32
+    LeaveMmcss();
+#endif
+}
+
+void ThreadTuner::Poll() {
+    uint64_t generation = app.tuning_generation.load(std::memory_order_relaxed);
+    if (generation == generation_) return;
+    generation_ = generation;
+    ThreadTuning t = app.Tuning(role_);
+    // Threads start untuned; nothing to undo until something was set
+    if (!tuned_ && t.cpus.empty() && t.priority == PRIORITY_NORMAL) return;
+    tuned_ = true;
+    std::string error;
+    if (!ApplyThreadTuning(role_, t, error)) app.Log("[ERR] Thread tuning (" + std::string(kThreadRoleNames[role_]) + "): " + error);
+}
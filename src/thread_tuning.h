@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPU pinning and scheduling class per pipeline thread role, plus the same for
+// the spawned engine.py processes.
+enum ThreadRole {
+    ROLE_CAPTURE = 0, // camera grab / external feed / replay, one thread per source
+    ROLE_ENCODE,      // JPEG encode or shm copy, one per source
+    ROLE_PUBLISH,     // frame PUB and multi-view sync
+    ROLE_RECEIVER,    // preview / pose SUB
+    ROLE_INFERENCE,   // in-process engine (ENGINE_NATIVE)
+    ROLE_OUTPUT,      // pose sinks, one per enabled output
+    ROLE_UI,          // ImGui render loop (GUI only)
+    THREAD_ROLE_COUNT
+};
+
+enum ThreadPriority {
+    PRIORITY_NORMAL = 0,
+    PRIORITY_HIGH,     // Linux nice -10, Windows THREAD_PRIORITY_HIGHEST / HIGH_PRIORITY_CLASS
+    PRIORITY_REALTIME, // Linux SCHED_FIFO, Windows THREAD_PRIORITY_TIME_CRITICAL + MMCSS / REALTIME_PRIORITY_CLASS
+    THREAD_PRIORITY_COUNT
+};
+
+extern const char* kThreadRoleNames[THREAD_ROLE_COUNT];   // config / UI names
+extern const char* kThreadPriorityNames[THREAD_PRIORITY_COUNT];
+
+struct ThreadTuning {
+    std::vector<int> cpus; // empty = any CPU
+    ThreadPriority priority = PRIORITY_NORMAL;
+};
+
+// Applies `t` to the calling thread. Raised priorities usually need
+// CAP_SYS_NICE / rtprio limits on Linux; `error` then says what was refused.
+bool ApplyThreadTuning(ThreadRole role, const ThreadTuning& t, std::string& error);
+
+// Each tuned thread owns one and calls Poll() once per loop iteration, so
+// settings changed in the UI or over "set" take effect on the running thread.
+// Poll() is one relaxed load unless something changed.
+class ThreadTuner {
+public:
+    explicit ThreadTuner(ThreadRole role) : role_(role) {}
+    ~ThreadTuner();
+    void Poll();
+
+private:
+    ThreadRole role_;
+    uint64_t generation_ = UINT64_MAX;
+    bool tuned_ = false;
+};
+
+// Same for a whole engine process, inherited by every thread it starts
+#ifdef _WIN32
+bool ApplyProcessTuning(void* process, const ThreadTuning& t, std::string& error);
+#else
+// For a forked child before exec: async-signal-safe, reports failures on stderr
+void ApplyTuningBeforeExec(const ThreadTuning& t);
+#endif
+
+// "2,3", or "any" for no pinning
+std::string FormatCpuList(const std::vector<int>& cpus);
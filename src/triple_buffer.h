@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single-producer/single-consumer triple buffer. The producer fills the back
+// buffer and publishes it by swapping it with the middle one; the consumer
+// swaps the middle buffer into the front when a fresh one is waiting. Neither
+// side ever blocks, and the consumer always sees the newest complete item.
+template <typename T>
+class TripleBuffer {
+public:
+    // --- Producer ---
+    T& WriteBuffer() { return buffers_[back_]; }
+    void Publish() {
+        uint8_t prev = middle_.exchange(uint8_t(back_ | kFresh), std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+    }
+
+    // --- Consumer ---
+    // Returns true if a newer item was swapped into the read buffer.
+    bool Update() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+        uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+    const T& ReadBuffer() const { return buffers_[front_]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    T buffers_[3];
+    alignas(64) std::atomic<uint8_t> middle_{ 1 };
+    alignas(64) uint8_t back_ = 0;  // producer-owned
+    alignas(64) uint8_t front_ = 2; // consumer-owned
+};
@@ -0,0 +1,70 @@
+#include "zmq_context.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "app_state.h"
+
+// Affinity applies to IO threads started after it is set, i.e. all of them
+// when done before the first socket exists
+static bool ConfigureContext(zmq::context_t& ctx) {
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+    for (int cpu : app.zmq_io_cpus) {
+        if (zmq_ctx_set(ctx.handle(), ZMQ_THREAD_AFFINITY_CPU_ADD, cpu) != 0) app.Log("[ERR] ZMQ IO thread affinity to CPU " + std::to_string(cpu) + " failed");
+    }
+#else
+    if (!app.zmq_io_cpus.empty()) app.Log("[ERR] ZMQ IO thread affinity needs libzmq 4.3 or newer");
+#endif
+    return true;
+}
+
+zmq::context_t& SharedZmqContext() {
+    static zmq::context_t ctx(std::max(1, app.zmq_io_threads));
+    static bool configured = ConfigureContext(ctx);
+    (void)configured;
+    return ctx;
+}
+
+bool IpcSupported() {
+    static const bool supported = zmq_has("ipc") != 0;
+    return supported;
+}
+
+bool UseLocalIpc() {
+    return IpcSupported() && app.engine_ipc;
+}
+
+std::string LocalIpcEndpoint(const std::string& channel) {
+#ifdef _WIN32
+    char dir[MAX_PATH + 1] = {};
+    DWORD n = GetTempPathA(sizeof(dir), dir);
+    std::string path = n ? std::string(dir, n) : std::string(".\\");
+    long pid = (long)GetCurrentProcessId();
+#else
+    // Socket paths are limited to ~100 bytes, so keep to short, private directories
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    std::string path = std::string(runtime && *runtime ? runtime : "/tmp") + "/";
+    long pid = (long)getpid();
+#endif
+    return "ipc://" + path + "posebridge-" + std::to_string(pid) + "-" + channel;
+}
+
+std::string ConnectEndpoint(const std::string& bind_endpoint) {
+    const std::string wildcard = "tcp://*:";
+    if (bind_endpoint.rfind(wildcard, 0) == 0) return "tcp://127.0.0.1:" + bind_endpoint.substr(wildcard.size());
+    return bind_endpoint;
+}
+
+std::string BindEndpoint(const std::string& connect_endpoint) {
+    if (connect_endpoint.rfind("tcp://", 0) != 0) return connect_endpoint;
+    size_t colon = connect_endpoint.rfind(':');
+    if (colon == std::string::npos || colon < 6) return connect_endpoint;
+    return "tcp://*" + connect_endpoint.substr(colon);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+#include <zmq.hpp>
+
+// The process's one ZMQ context. Every socket is created from it, so the IO
+// threads are shared and inproc:// endpoints resolve between threads. It is
+// created on first use from app.zmq_io_threads / app.zmq_io_cpus, which must
+// be set before any pipeline thread starts.
+zmq::context_t& SharedZmqContext();
+
+// In-process tap of the frame stream: PublishThread binds it next to
+// app.frames_endpoint, so same-process consumers skip the TCP stack
+constexpr const char* kInprocFramesEndpoint = "inproc://posebridge-frames";
+
+// The engine.py that PoseBridge spawns is reached over ipc:// (Unix domain
+// sockets; AF_UNIX on Windows 10+) when app.engine_ipc is on. The ipc
+// endpoints are always served next to the TCP ones, which stay for remote
+// engines; setting a TCP endpoint to "" drops it (and its port).
+bool IpcSupported(); // libzmq was built with ipc://
+bool UseLocalIpc();  // IpcSupported() && app.engine_ipc
+// ipc:// endpoint for `channel` ("frames", "preview", "pose", "control"), private to this process
+std::string LocalIpcEndpoint(const std::string& channel);
+
+// The address a local peer uses for one of our binds: "tcp://*:6000" -> "tcp://127.0.0.1:6000"
+std::string ConnectEndpoint(const std::string& bind_endpoint);
+// The address the engine binds for one of our connects: "tcp://127.0.0.1:6001" -> "tcp://*:6001"
+std::string BindEndpoint(const std::string& connect_endpoint);